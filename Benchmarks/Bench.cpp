@@ -0,0 +1,224 @@
+// Bench.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Bench.h"
+#include "Fiber/FiberScheduler.h"
+#include "Semaphore.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#if defined(__LINUX__)
+	#include <sched.h>
+#endif
+
+
+void Bench::Report::Add(Result&& result)
+{
+	m_Results.push_back(std::move(result));
+}
+
+void Bench::Report::Print() const
+{
+	// Keep the order the benchmarks ran in
+	std::vector<std::string> names;
+	std::map<std::string, std::vector<const Result*>> byName;
+	for (const Result& result : m_Results)
+	{
+		auto& rows = byName[result.m_Name];
+		if (rows.empty())
+			names.push_back(result.m_Name);
+		rows.push_back(&result);
+	}
+
+	for (const std::string& name : names)
+	{
+		auto& rows = byName[name];
+		std::sort(rows.begin(), rows.end(), [](const Result* a, const Result* b) { return a->m_Cpus < b->m_Cpus; });
+		const Result* first = rows.front();
+		double firstNS = GetPercentile(first->m_Samples, 0.5);
+
+		printf("\n%s\n", name.c_str());
+		printf("  %4s %7s %14s %14s %14s %14s %12s %8s %8s %12s\n", "cpus", "workers", "ns/op", "p50", "p90", "p99", "ops/s", "scaling", "speedup", "pool ns/op");
+		for (const Result* row : rows)
+		{
+			double median = GetPercentile(row->m_Samples, 0.5);
+			char scaling[16] = "-";
+			if (row->m_Parallel && median > 0.0)
+				snprintf(scaling, sizeof(scaling), "%.0f%%", 100.0 * firstNS * first->m_Cpus / (median * row->m_Cpus));
+			char speedup[16] = "-";
+			if (row->m_SerialNS >= 0.0 && median > 0.0)
+				snprintf(speedup, sizeof(speedup), "%.2fx", row->m_SerialNS / median);
+			char baseline[16] = "-";
+			if (row->m_BaselineNS >= 0.0)
+				snprintf(baseline, sizeof(baseline), "%.1f", row->m_BaselineNS);
+			double mean = GetMean(row->m_Samples);
+			printf("  %4u %7u %14.1f %14.1f %14.1f %14.1f %12.0f %8s %8s %12s\n", row->m_Cpus, row->m_Workers, mean,
+				median, GetPercentile(row->m_Samples, 0.9), GetPercentile(row->m_Samples, 0.99),
+				mean > 0.0 ? 1e9 / mean : 0.0, scaling, speedup, baseline);
+			if (!row->m_Error.empty())
+				printf("  ERROR: %s\n", row->m_Error.c_str());
+		}
+	}
+	printf("\n");
+}
+
+
+bool Bench::Report::HasErrors() const
+{
+	for (const Result& result : m_Results)
+		if (!result.m_Error.empty())
+			return true;
+	return false;
+}
+
+
+uint64 Bench::NowNS()
+{
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if defined(__LINUX__)
+// CPUs the process started with, restricting always picks from those
+static cpu_set_t s_StartCpus;
+static bool      s_StartCpusRead = false;
+
+static const cpu_set_t& GetStartCpus()
+{
+	if (!s_StartCpusRead)
+	{
+		CPU_ZERO(&s_StartCpus);
+		if (sched_getaffinity(0, sizeof(s_StartCpus), &s_StartCpus) != 0)
+			for (uint32 i = 0; i < std::thread::hardware_concurrency(); ++i)
+				CPU_SET(i, &s_StartCpus);
+		s_StartCpusRead = true;
+	}
+	return s_StartCpus;
+}
+#endif
+
+uint32 Bench::GetCpuCount()
+{
+#if defined(__LINUX__)
+	return (uint32)CPU_COUNT(&GetStartCpus());
+#else
+	return TMAX(std::thread::hardware_concurrency(), 1u);
+#endif
+}
+
+std::vector<uint32> Bench::GetCpuSweep(uint32 maxCpus)
+{
+	std::vector<uint32> sweep;
+	for (uint32 count = 1; count < maxCpus; count *= 2)
+		sweep.push_back(count);
+	sweep.push_back(maxCpus);
+	return sweep;
+}
+
+bool Bench::RestrictCpus(uint32 count)
+{
+#if defined(__LINUX__)
+	const cpu_set_t& start = GetStartCpus();
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (uint32 cpu = 0, picked = 0; cpu < CPU_SETSIZE && picked < count; ++cpu)
+	{
+		if (CPU_ISSET(cpu, &start))
+		{
+			CPU_SET(cpu, &set);
+			++picked;
+		}
+	}
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+double Bench::GetPercentile(std::vector<double> samples, double fraction)
+{
+	if (samples.empty())
+		return 0.0;
+	SIZET index = TMIN((SIZET)(fraction * (double)samples.size()), samples.size() - 1);
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+	return samples[index];
+}
+
+double Bench::GetMean(const std::vector<double>& samples)
+{
+	double sum = 0.0;
+	for (double sample : samples)
+		sum += sample;
+	return samples.empty() ? 0.0 : sum / samples.size();
+}
+
+bool Bench::IsSelected(const Config& config, const char* name)
+{
+	return config.m_Filter.empty() || std::string(name).find(config.m_Filter) != std::string::npos;
+}
+
+void Bench::RunInJob(FiberScheduler* sche, const std::function<void()>& body)
+{
+	Semaphore done;
+	sche->PostJob([&body, &done]() {
+		body();
+		done.Notify();
+	});
+	done.Wait();
+}
+
+
+Bench::ThreadPool::ThreadPool(uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+		m_Threads.emplace_back([this]() { Main(); });
+}
+
+Bench::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_Stopped = true;
+	}
+	m_TaskReady.notify_all();
+	for (auto& thread : m_Threads)
+		thread.join();
+}
+
+void Bench::ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_Tasks.push_back(std::move(task));
+		++m_Pending;
+	}
+	m_TaskReady.notify_one();
+}
+
+void Bench::ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_Lock);
+	m_Idle.wait(lock, [this]() { return m_Pending == 0; });
+}
+
+void Bench::ThreadPool::Main()
+{
+	std::unique_lock<std::mutex> lock(m_Lock);
+	while (true)
+	{
+		m_TaskReady.wait(lock, [this]() { return m_Stopped || !m_Tasks.empty(); });
+		if (m_Tasks.empty())
+			return;
+		std::function<void()> task = std::move(m_Tasks.front());
+		m_Tasks.pop_front();
+		lock.unlock();
+		task();
+		lock.lock();
+		if (--m_Pending == 0)
+			m_Idle.notify_all();
+	}
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
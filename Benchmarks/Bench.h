@@ -0,0 +1,103 @@
+// Bench.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FiberScheduler;
+
+
+// namespace Bench
+//------------------------------------------------------------------------------
+// Shared pieces of the benchmark suites. A suite runs once per CPU count of the
+// sweep, with the process restricted to that many CPUs, and adds a result per
+// benchmark to the report. Samples are nanoseconds per operation.
+namespace Bench
+{
+	struct Config
+	{
+		uint32      m_MaxCpus{ 0 };
+		bool        m_Quick{ false };		// smaller sizes, for a smoke run
+		std::string m_Filter;				// only benchmarks whose name contains it
+	};
+
+	struct Result
+	{
+		std::string         m_Name;
+		uint32              m_Cpus{ 0 };
+		uint32              m_Workers{ 0 };
+		std::vector<double> m_Samples;
+		double              m_BaselineNS{ -1.0 };		// std::thread pool, negative when it has no counterpart
+		double              m_SerialNS{ -1.0 };			// the same work on one thread, for the speedup
+		bool                m_Parallel{ false };		// work spreads over the CPUs, so scaling is reported
+		std::string         m_Error;					// the run computed something else than the serial one
+	};
+
+	class Report
+	{
+	public:
+		void Add(Result&& result);
+		// A table per benchmark, efficiency is against the smallest CPU count of the sweep
+		void Print() const;
+		bool HasErrors() const;
+
+	private:
+		std::vector<Result> m_Results;
+	};
+
+	uint64 NowNS();
+	uint32 GetCpuCount();
+	// 1, 2, 4... up to the count, which is always included
+	std::vector<uint32> GetCpuSweep(uint32 maxCpus);
+	// Limits the calling thread to the first count CPUs it was allowed to start with, threads it
+	// creates from now on inherit that. Only Linux restricts, elsewhere all CPUs stay in use.
+	bool   RestrictCpus(uint32 count);
+	double GetPercentile(std::vector<double> samples, double fraction);
+	double GetMean(const std::vector<double>& samples);
+	bool   IsSelected(const Config& config, const char* name);
+	// Runs body in a job of the scheduler, the calling thread blocks until it returns
+	void   RunInJob(FiberScheduler* sche, const std::function<void()>& body);
+
+	// Suites, each runs its benchmarks with the process limited to cpus
+	void   RunMicroBenchmarks(const Config& config, uint32 cpus, Report& report);
+	void   RunMacroBenchmarks(const Config& config, uint32 cpus, Report& report);
+
+
+	// Baseline: a mutex and condition variable around one queue, what a plain pool does
+	class ThreadPool
+	{
+	public:
+		explicit ThreadPool(uint32 count);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+
+		void Submit(std::function<void()> task);
+		// Returns once every task submitted so far has run
+		void Wait();
+
+	private:
+		void Main();
+
+		std::vector<std::thread>          m_Threads;
+		std::deque<std::function<void()>> m_Tasks;
+		std::mutex                        m_Lock;
+		std::condition_variable           m_TaskReady;
+		std::condition_variable           m_Idle;
+		uint64                            m_Pending{ 0 };
+		bool                              m_Stopped{ false };
+	};
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
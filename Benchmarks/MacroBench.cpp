@@ -0,0 +1,450 @@
+// MacroBench.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Bench.h"
+#include "Fiber/FiberScheduler.h"
+#include "Fiber/FiberSync.h"
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <random>
+#include <string.h>
+
+using namespace Bench;
+
+// Static
+//------------------------------------------------------------------------------
+namespace
+{
+	struct Sizes
+	{
+		uint32 m_Runs;
+		uint32 m_Fib;				// fib(m_Fib), serial below m_FibCutoff
+		uint32 m_FibCutoff;
+		uint32 m_Queens;			// board size, a job per placement in the first m_QueensDepth rows
+		uint32 m_QueensDepth;
+		uint32 m_Matrix;			// square matrices, a job per output block
+		uint32 m_MatrixBlock;
+		uint32 m_Wave;				// square grid, a job per block once its upper and left blocks are done
+		uint32 m_WaveBlock;
+		uint32 m_DagNodes;			// a job per node, run once all of its predecessors are
+		uint32 m_DagWork;			// average spin iterations per node
+	};
+
+	struct Context
+	{
+		Sizes           m_Sizes;
+		FiberScheduler* m_Scheduler;
+		FiberSemaphore* m_Done;		// outlives the scheduler, the last job may still be in Release when the waiter goes on
+	};
+
+	Sizes GetSizes(const Config& config)
+	{
+		if (config.m_Quick)
+			return { 2, 24, 14, 8, 2, 128, 32, 256, 32, 1000, 500 };
+		return { 5, 34, 20, 12, 3, 512, 64, 2048, 64, 20000, 2000 };
+	}
+
+	// Deterministic busy work, the result keeps the compiler from dropping it
+	uint64 Spin(uint64 seed, uint32 iterations)
+	{
+		for (uint32 i = 0; i < iterations; ++i)
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+		return seed;
+	}
+}
+
+
+// Recursive fibonacci, one half in a child job and the other inline
+//------------------------------------------------------------------------------
+static uint64 FibSerial(uint32 n)
+{
+	return n < 2 ? n : FibSerial(n - 1) + FibSerial(n - 2);
+}
+
+static uint64 FibParallel(FiberScheduler* sche, uint32 n, uint32 cutoff)
+{
+	if (n < cutoff)
+		return FibSerial(n);
+	uint64 left = 0;
+	FiberJobPtr job = sche->PostJob([sche, n, cutoff, &left]() { left = FibParallel(sche, n - 1, cutoff); });
+	uint64 right = FibParallel(sche, n - 2, cutoff);
+	sche->YieldFor(job->GetSignal());
+	return left + right;
+}
+
+static uint64 BenchFib(Context& context, bool parallel)
+{
+	const Sizes& sizes = context.m_Sizes;
+	if (!parallel)
+		return FibSerial(sizes.m_Fib);
+	uint64 result = 0;
+	RunInJob(context.m_Scheduler, [&]() { result = FibParallel(context.m_Scheduler, sizes.m_Fib, sizes.m_FibCutoff); });
+	return result;
+}
+
+
+// N-queens on bitmasks, the first rows fan out in jobs joined on their signals
+//------------------------------------------------------------------------------
+static uint64 QueensSerial(uint32 all, uint32 cols, uint32 left, uint32 right)
+{
+	if (cols == all)
+		return 1;
+	uint64 count = 0;
+	for (uint32 free = all & ~(cols | left | right); free; free &= free - 1)
+	{
+		uint32 bit = free & (0 - free);
+		count += QueensSerial(all, cols | bit, (left | bit) << 1, (right | bit) >> 1);
+	}
+	return count;
+}
+
+static uint64 QueensParallel(FiberScheduler* sche, uint32 all, uint32 cols, uint32 left, uint32 right, uint32 depth)
+{
+	if (depth == 0 || cols == all)
+		return QueensSerial(all, cols, left, right);
+
+	std::array<uint64, 32> counts{};
+	std::array<FiberJobPtr, 32> jobs;
+	uint32 spawned = 0;
+	for (uint32 free = all & ~(cols | left | right); free; free &= free - 1)
+	{
+		uint32 bit = free & (0 - free);
+		uint64* count = &counts[spawned];
+		jobs[spawned++] = sche->PostJob([sche, all, cols, left, right, depth, bit, count]() {
+			*count = QueensParallel(sche, all, cols | bit, (left | bit) << 1, (right | bit) >> 1, depth - 1);
+		});
+	}
+	uint64 total = 0;
+	for (uint32 i = 0; i < spawned; ++i)
+	{
+		sche->YieldFor(jobs[i]->GetSignal());
+		total += counts[i];
+	}
+	return total;
+}
+
+static uint64 BenchQueens(Context& context, bool parallel)
+{
+	const Sizes& sizes = context.m_Sizes;
+	uint32 all = (1u << sizes.m_Queens) - 1;
+	if (!parallel)
+		return QueensSerial(all, 0, 0, 0);
+	uint64 result = 0;
+	RunInJob(context.m_Scheduler, [&]() { result = QueensParallel(context.m_Scheduler, all, 0, 0, 0, sizes.m_QueensDepth); });
+	return result;
+}
+
+
+// Blocked matrix multiply, the output blocks posted as one batch
+//------------------------------------------------------------------------------
+struct MatrixSet
+{
+	std::vector<float> m_A;
+	std::vector<float> m_B;
+	std::vector<float> m_C;
+};
+
+// Both versions go through here, so they add in the same order and agree to the bit
+static void MultiplyBlock(const float* a, const float* b, float* c, uint32 n, uint32 block, uint32 bi, uint32 bj)
+{
+	for (uint32 i = bi; i < bi + block; ++i)
+	{
+		float* row = c + (SIZET)i * n;
+		for (uint32 j = bj; j < bj + block; ++j)
+			row[j] = 0.0f;
+		for (uint32 k = 0; k < n; ++k)
+		{
+			float value = a[(SIZET)i * n + k];
+			const float* other = b + (SIZET)k * n;
+			for (uint32 j = bj; j < bj + block; ++j)
+				row[j] += value * other[j];
+		}
+	}
+}
+
+static uint64 BenchMatrix(Context& context, bool parallel)
+{
+	const Sizes& sizes = context.m_Sizes;
+	uint32 n = sizes.m_Matrix;
+	uint32 block = sizes.m_MatrixBlock;
+	static MatrixSet s_Matrices;
+	if (s_Matrices.m_A.size() != (SIZET)n * n)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> values(-1.0f, 1.0f);
+		s_Matrices.m_A.resize((SIZET)n * n);
+		s_Matrices.m_B.resize((SIZET)n * n);
+		for (SIZET i = 0; i < (SIZET)n * n; ++i)
+		{
+			s_Matrices.m_A[i] = values(random);
+			s_Matrices.m_B[i] = values(random);
+		}
+	}
+	s_Matrices.m_C.assign((SIZET)n * n, 0.0f);
+	const float* a = s_Matrices.m_A.data();
+	const float* b = s_Matrices.m_B.data();
+	float* c = s_Matrices.m_C.data();
+
+	if (!parallel)
+	{
+		for (uint32 bi = 0; bi < n; bi += block)
+			for (uint32 bj = 0; bj < n; bj += block)
+				MultiplyBlock(a, b, c, n, block, bi, bj);
+	}
+	else
+	{
+		auto makeJob = [a, b, c, n, block](uint32 bi, uint32 bj) {
+			return [a, b, c, n, block, bi, bj]() { MultiplyBlock(a, b, c, n, block, bi, bj); };
+		};
+		std::vector<decltype(makeJob(0, 0))> jobs;
+		for (uint32 bi = 0; bi < n; bi += block)
+			for (uint32 bj = 0; bj < n; bj += block)
+				jobs.push_back(makeJob(bi, bj));
+		RunInJob(context.m_Scheduler, [&]() {
+			context.m_Scheduler->YieldFor(context.m_Scheduler->PostBatch(jobs.begin(), jobs.end()));
+		});
+	}
+
+	// Checksum of the bits, any difference in any element shows
+	uint64 checksum = 0;
+	for (float value : s_Matrices.m_C)
+	{
+		uint32 bits;
+		memcpy(&bits, &value, sizeof(bits));
+		checksum = checksum * 31 + bits;
+	}
+	return checksum;
+}
+
+
+// 2D wavefront, a block starts once the blocks above and to its left are done
+//------------------------------------------------------------------------------
+struct WaveGrid
+{
+	FiberScheduler*                        m_Scheduler;
+	FiberSemaphore*                        m_Done;
+	std::vector<uint32>                    m_Cells;
+	std::unique_ptr<std::atomic<uint32>[]> m_Pending;		// blocks above and left still running
+	uint32                                 m_Size;
+	uint32                                 m_Block;
+	uint32                                 m_Blocks;		// per side
+};
+
+static void ComputeWaveBlock(WaveGrid* grid, uint32 bi, uint32 bj)
+{
+	uint32 n = grid->m_Size;
+	uint32* cells = grid->m_Cells.data();
+	for (uint32 i = bi * grid->m_Block; i < (bi + 1) * grid->m_Block; ++i)
+	{
+		for (uint32 j = bj * grid->m_Block; j < (bj + 1) * grid->m_Block; ++j)
+		{
+			uint32 up = i ? cells[(SIZET)(i - 1) * n + j] : j;
+			uint32 left = j ? cells[(SIZET)i * n + j - 1] : i;
+			uint32 diagonal = i && j ? cells[(SIZET)(i - 1) * n + j - 1] : 0;
+			cells[(SIZET)i * n + j] = (up ^ left) * 2654435761u + diagonal + 1;
+		}
+	}
+}
+
+static void RunWaveBlock(WaveGrid* grid, uint32 bi, uint32 bj)
+{
+	ComputeWaveBlock(grid, bi, bj);
+	uint32 blocks = grid->m_Blocks;
+	if (bi + 1 == blocks && bj + 1 == blocks)
+	{
+		grid->m_Done->Release();
+		return;
+	}
+	// The last of the two blocks a neighbour waits for posts it
+	if (bj + 1 < blocks && grid->m_Pending[bi * blocks + bj + 1].fetch_sub(1, std::memory_order_acq_rel) == 1)
+		grid->m_Scheduler->PostJob([grid, bi, bj]() { RunWaveBlock(grid, bi, bj + 1); });
+	if (bi + 1 < blocks && grid->m_Pending[(bi + 1) * blocks + bj].fetch_sub(1, std::memory_order_acq_rel) == 1)
+		grid->m_Scheduler->PostJob([grid, bi, bj]() { RunWaveBlock(grid, bi + 1, bj); });
+}
+
+static uint64 BenchWavefront(Context& context, bool parallel)
+{
+	const Sizes& sizes = context.m_Sizes;
+	WaveGrid grid;
+	grid.m_Scheduler = context.m_Scheduler;
+	grid.m_Done = context.m_Done;
+	grid.m_Size = sizes.m_Wave;
+	grid.m_Block = sizes.m_WaveBlock;
+	grid.m_Blocks = sizes.m_Wave / sizes.m_WaveBlock;
+	grid.m_Cells.assign((SIZET)grid.m_Size * grid.m_Size, 0);
+
+	uint32 blocks = grid.m_Blocks;
+	if (!parallel)
+	{
+		for (uint32 bi = 0; bi < blocks; ++bi)
+			for (uint32 bj = 0; bj < blocks; ++bj)
+				ComputeWaveBlock(&grid, bi, bj);
+	}
+	else
+	{
+		grid.m_Pending.reset(new std::atomic<uint32>[(SIZET)blocks * blocks]);
+		for (uint32 bi = 0; bi < blocks; ++bi)
+			for (uint32 bj = 0; bj < blocks; ++bj)
+				grid.m_Pending[bi * blocks + bj].store((bi ? 1 : 0) + (bj ? 1 : 0), std::memory_order_relaxed);
+		RunInJob(context.m_Scheduler, [&]() {
+			WaveGrid* shared = &grid;
+			context.m_Scheduler->PostJob([shared]() { RunWaveBlock(shared, 0, 0); });
+			context.m_Done->Acquire();
+		});
+	}
+	return grid.m_Cells.back();
+}
+
+
+// Random DAG, each node depends on a few of the nodes shortly before it
+//------------------------------------------------------------------------------
+struct DagNode
+{
+	std::vector<uint32> m_Predecessors;
+	std::vector<uint32> m_Successors;
+	uint32              m_Work{ 0 };
+	uint64              m_Value{ 0 };
+	std::atomic<uint32> m_Pending{ 0 };
+};
+
+struct DagGraph
+{
+	FiberScheduler*                       m_Scheduler;
+	FiberSemaphore*                       m_Done;
+	std::vector<std::unique_ptr<DagNode>> m_Nodes;
+	std::atomic<uint32>                   m_Remaining{ 0 };
+};
+
+// A node's value folds in its predecessors', so any node run too early changes the sum
+static void ComputeDagNode(DagGraph* graph, uint32 index)
+{
+	DagNode* node = graph->m_Nodes[index].get();
+	uint64 value = Spin(index, node->m_Work);
+	for (uint32 predecessor : node->m_Predecessors)
+		value += graph->m_Nodes[predecessor]->m_Value * 31;
+	node->m_Value = value;
+}
+
+static void RunDagNode(DagGraph* graph, uint32 index)
+{
+	ComputeDagNode(graph, index);
+	for (uint32 successor : graph->m_Nodes[index]->m_Successors)
+	{
+		if (graph->m_Nodes[successor]->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			graph->m_Scheduler->PostJob([graph, successor]() { RunDagNode(graph, successor); });
+	}
+	if (graph->m_Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		graph->m_Done->Release();
+}
+
+static uint64 BenchDag(Context& context, bool parallel)
+{
+	const Sizes& sizes = context.m_Sizes;
+	DagGraph graph;
+	graph.m_Scheduler = context.m_Scheduler;
+	graph.m_Done = context.m_Done;
+
+	// Same seed every run, so the serial and the parallel runs see the same graph
+	std::mt19937 random(11);
+	std::uniform_int_distribution<uint32> edges(0, 4);
+	std::uniform_int_distribution<uint32> work(sizes.m_DagWork / 4, sizes.m_DagWork * 7 / 4);
+	for (uint32 i = 0; i < sizes.m_DagNodes; ++i)
+	{
+		graph.m_Nodes.emplace_back(new DagNode());
+		DagNode* node = graph.m_Nodes.back().get();
+		node->m_Work = work(random);
+		uint32 window = TMIN(i, 64u);
+		for (uint32 e = edges(random); e > 0 && window > 0; --e)
+		{
+			uint32 predecessor = i - 1 - random() % window;
+			if (std::find(node->m_Predecessors.begin(), node->m_Predecessors.end(), predecessor) != node->m_Predecessors.end())
+				continue;
+			node->m_Predecessors.push_back(predecessor);
+			graph.m_Nodes[predecessor]->m_Successors.push_back(i);
+		}
+	}
+
+	if (!parallel)
+	{
+		for (uint32 i = 0; i < sizes.m_DagNodes; ++i)
+			ComputeDagNode(&graph, i);
+	}
+	else
+	{
+		graph.m_Remaining.store(sizes.m_DagNodes, std::memory_order_relaxed);
+		for (auto& node : graph.m_Nodes)
+			node->m_Pending.store((uint32)node->m_Predecessors.size(), std::memory_order_relaxed);
+		RunInJob(context.m_Scheduler, [&]() {
+			DagGraph* shared = &graph;
+			for (uint32 i = 0; i < sizes.m_DagNodes; ++i)
+				if (graph.m_Nodes[i]->m_Predecessors.empty())
+					context.m_Scheduler->PostJob([shared, i]() { RunDagNode(shared, i); });
+			context.m_Done->Acquire();
+		});
+	}
+
+	uint64 checksum = 0;
+	for (auto& node : graph.m_Nodes)
+		checksum += node->m_Value;
+	return checksum;
+}
+
+
+void Bench::RunMacroBenchmarks(const Config& config, uint32 cpus, Report& report)
+{
+	struct Benchmark
+	{
+		const char* m_Name;
+		uint64    (*m_Run)(Context&, bool parallel);		// returns a checksum both versions must agree on
+	};
+	static const Benchmark benchmarks[] = {
+		{ "fib", BenchFib },
+		{ "n-queens", BenchQueens },
+		{ "blocked matmul", BenchMatrix },
+		{ "wavefront", BenchWavefront },
+		{ "random DAG", BenchDag },
+	};
+
+	// Declared first so it goes last, after the workers have exited
+	FiberSemaphore done;
+	std::unique_ptr<FiberScheduler> sche(new FiberScheduler);
+	sche->InitWorker((uint8)TMIN(cpus + 1, (uint32)THREAD_COUNT_MAX));
+	uint32 workers = (uint32)sche->GetStats().m_Workers.size();
+
+	Context context{ GetSizes(config), sche.get(), &done };
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (!IsSelected(config, benchmark.m_Name))
+			continue;
+		Result result;
+		result.m_Name = benchmark.m_Name;
+		result.m_Cpus = cpus;
+		result.m_Workers = workers;
+		result.m_Parallel = true;
+
+		std::vector<double> serial;
+		uint64 expected = 0;
+		for (uint32 run = 0; run < context.m_Sizes.m_Runs; ++run)
+		{
+			uint64 start = NowNS();
+			expected = benchmark.m_Run(context, false);
+			serial.push_back((double)(NowNS() - start));
+		}
+		result.m_SerialNS = GetPercentile(serial, 0.5);
+
+		for (uint32 run = 0; run < context.m_Sizes.m_Runs; ++run)
+		{
+			uint64 start = NowNS();
+			uint64 checksum = benchmark.m_Run(context, true);
+			result.m_Samples.push_back((double)(NowNS() - start));
+			if (checksum != expected && result.m_Error.empty())
+				result.m_Error = "checksum " + std::to_string(checksum) + " differs from the serial " + std::to_string(expected);
+		}
+		report.Add(std::move(result));
+	}
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,233 @@
+// MicroBench.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Bench.h"
+#include "Fiber/Fiber.h"
+#include "Fiber/FiberScheduler.h"
+#include "Fiber/FiberSync.h"
+#include "Semaphore.h"
+#include <memory>
+
+using namespace Bench;
+
+// Static
+//------------------------------------------------------------------------------
+namespace
+{
+	struct Sizes
+	{
+		uint32 m_RoundTrips;		// latency samples
+		uint32 m_Runs;				// samples of the bulk benchmarks
+		uint32 m_Jobs;				// jobs per throughput run
+		uint32 m_FanOut;
+		uint32 m_FanRounds;			// per fan run
+		uint32 m_Chain;
+		uint32 m_Switches;			// round trips per switch sample
+	};
+
+	struct Context
+	{
+		Sizes           m_Sizes;
+		FiberScheduler* m_Scheduler;
+		ThreadPool*     m_Pool;
+		FiberSemaphore* m_Done;		// outlives the scheduler, the last job may still be in Release when the waiter goes on
+	};
+
+	Sizes GetSizes(const Config& config)
+	{
+		if (config.m_Quick)
+			return { 200, 3, 10000, 64, 20, 2000, 1000 };
+		return { 5000, 10, 200000, 64, 500, 50000, 10000 };
+	}
+}
+
+// An empty job posted from outside the scheduler, until its completion wakes the poster
+static void BenchPostLatency(Context& context, Result& result)
+{
+	Semaphore done;
+	for (uint32 i = 0; i < context.m_Sizes.m_RoundTrips; ++i)
+	{
+		uint64 start = NowNS();
+		context.m_Scheduler->PostJob([&done]() { done.Notify(); });
+		done.Wait();
+		result.m_Samples.push_back((double)(NowNS() - start));
+	}
+
+	std::vector<double> baseline;
+	for (uint32 i = 0; i < context.m_Sizes.m_RoundTrips; ++i)
+	{
+		uint64 start = NowNS();
+		context.m_Pool->Submit([&done]() { done.Notify(); });
+		done.Wait();
+		baseline.push_back((double)(NowNS() - start));
+	}
+	result.m_BaselineNS = GetMean(baseline);
+}
+
+// Independent empty jobs posted one by one from a job, per job
+static void BenchThroughput(Context& context, Result& result)
+{
+	FiberScheduler* sche = context.m_Scheduler;
+	uint32 count = context.m_Sizes.m_Jobs;
+	RunInJob(sche, [&]() {
+		for (uint32 run = 0; run < context.m_Sizes.m_Runs; ++run)
+		{
+			std::atomic<uint32> remaining(count);
+			FiberSemaphore* done = context.m_Done;
+			uint64 start = NowNS();
+			for (uint32 i = 0; i < count; ++i)
+			{
+				sche->PostJob([&remaining, done]() {
+					if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+						done->Release();
+				});
+			}
+			done->Acquire();
+			result.m_Samples.push_back((double)(NowNS() - start) / count);
+		}
+	});
+
+	std::vector<double> baseline;
+	for (uint32 run = 0; run < context.m_Sizes.m_Runs; ++run)
+	{
+		uint64 start = NowNS();
+		for (uint32 i = 0; i < count; ++i)
+			context.m_Pool->Submit([]() {});
+		context.m_Pool->Wait();
+		baseline.push_back((double)(NowNS() - start) / count);
+	}
+	result.m_BaselineNS = GetMean(baseline);
+}
+
+// A batch of empty children joined by one signal, per round
+static void BenchFanOut(Context& context, Result& result)
+{
+	FiberScheduler* sche = context.m_Scheduler;
+	const Sizes& sizes = context.m_Sizes;
+	auto child = []() {};
+	std::vector<decltype(child)> children(sizes.m_FanOut, child);
+	RunInJob(sche, [&]() {
+		for (uint32 run = 0; run < sizes.m_Runs; ++run)
+		{
+			uint64 start = NowNS();
+			for (uint32 round = 0; round < sizes.m_FanRounds; ++round)
+				sche->YieldFor(sche->PostBatch(children.begin(), children.end()));
+			result.m_Samples.push_back((double)(NowNS() - start) / sizes.m_FanRounds);
+		}
+	});
+
+	std::vector<double> baseline;
+	for (uint32 run = 0; run < sizes.m_Runs; ++run)
+	{
+		uint64 start = NowNS();
+		for (uint32 round = 0; round < sizes.m_FanRounds; ++round)
+		{
+			for (uint32 i = 0; i < sizes.m_FanOut; ++i)
+				context.m_Pool->Submit(child);
+			context.m_Pool->Wait();
+		}
+		baseline.push_back((double)(NowNS() - start) / sizes.m_FanRounds);
+	}
+	result.m_BaselineNS = GetMean(baseline);
+}
+
+// Each job posted as the successor of the previous one, per link
+static void BenchChain(Context& context, Result& result)
+{
+	FiberScheduler* sche = context.m_Scheduler;
+	uint32 length = context.m_Sizes.m_Chain;
+	RunInJob(sche, [&]() {
+		for (uint32 run = 0; run < context.m_Sizes.m_Runs; ++run)
+		{
+			uint64 start = NowNS();
+			FiberJobPtr job = sche->PostJob([]() {});
+			for (uint32 i = 1; i < length; ++i)
+				job = job->PostSuccessor([]() {});
+			sche->YieldFor(job->GetSignal());
+			result.m_Samples.push_back((double)(NowNS() - start) / length);
+		}
+	});
+}
+
+// Post an empty job and wait for it inside a job, the fiber is suspended and resumed
+static void BenchYieldFor(Context& context, Result& result)
+{
+	FiberScheduler* sche = context.m_Scheduler;
+	RunInJob(sche, [&]() {
+		for (uint32 i = 0; i < context.m_Sizes.m_RoundTrips; ++i)
+		{
+			uint64 start = NowNS();
+			sche->YieldFor(sche->PostJob([]() {})->GetSignal());
+			result.m_Samples.push_back((double)(NowNS() - start));
+		}
+	});
+}
+
+// Bare context switches between the thread and a fiber, per switch
+static void* s_ThreadFiber = nullptr;
+
+static void SwitchBack(void*)
+{
+	while (true)
+		Fiber::SwitchTo(s_ThreadFiber);
+}
+
+static void BenchSwitch(Context& context, Result& result)
+{
+	// The thread is converted once and stays a fiber
+	if (!s_ThreadFiber)
+		s_ThreadFiber = Fiber::InitFromThread();
+	void* fiber = Fiber::CreateFiber(16 * KILOBYTE, SwitchBack, nullptr);
+	for (uint32 run = 0; run < context.m_Sizes.m_Runs; ++run)
+	{
+		uint64 start = NowNS();
+		for (uint32 i = 0; i < context.m_Sizes.m_Switches; ++i)
+			Fiber::SwitchTo(fiber);
+		result.m_Samples.push_back((double)(NowNS() - start) / (2.0 * context.m_Sizes.m_Switches));
+	}
+	Fiber::DestroyFiber(fiber);
+}
+
+
+void Bench::RunMicroBenchmarks(const Config& config, uint32 cpus, Report& report)
+{
+	struct Benchmark
+	{
+		const char* m_Name;
+		void      (*m_Run)(Context&, Result&);
+		bool        m_Parallel;
+	};
+	static const Benchmark benchmarks[] = {
+		{ "post-to-complete latency", BenchPostLatency, false },
+		{ "independent jobs", BenchThroughput, true },
+		{ "fan-out/fan-in x64", BenchFanOut, true },
+		{ "PostSuccessor chain", BenchChain, false },
+		{ "YieldFor round trip", BenchYieldFor, false },
+		{ "Fiber::SwitchTo", BenchSwitch, false },
+	};
+
+	// Declared first so it goes last, after the workers have exited
+	FiberSemaphore done;
+	ThreadPool pool(cpus);
+	std::unique_ptr<FiberScheduler> sche(new FiberScheduler);
+	sche->InitWorker((uint8)TMIN(cpus + 1, (uint32)THREAD_COUNT_MAX));
+	uint32 workers = (uint32)sche->GetStats().m_Workers.size();
+
+	Context context{ GetSizes(config), sche.get(), &pool, &done };
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (!IsSelected(config, benchmark.m_Name))
+			continue;
+		Result result;
+		result.m_Name = benchmark.m_Name;
+		result.m_Cpus = cpus;
+		result.m_Workers = workers;
+		result.m_Parallel = benchmark.m_Parallel;
+		benchmark.m_Run(context, result);
+		report.Add(std::move(result));
+	}
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
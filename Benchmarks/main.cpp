@@ -0,0 +1,66 @@
+// main.cpp
+//------------------------------------------------------------------------------
+#include "Bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void PrintUsage()
+{
+	printf("FiberLibBench [--suite micro|macro|all] [--cpus N] [--quick] [--filter TEXT]\n");
+	printf("  --suite NAME   scheduler primitives, task-parallel kernels against serial, or both by default\n");
+	printf("  --cpus N       sweep 1, 2, 4... up to N CPUs, all of them by default\n");
+	printf("  --quick        small sizes, a smoke run rather than a measurement\n");
+	printf("  --filter TEXT  only run benchmarks whose name contains TEXT\n");
+}
+
+int main(int argc, char* argv[])
+{
+	Bench::Config config;
+	config.m_MaxCpus = Bench::GetCpuCount();
+	bool micro = true;
+	bool macro = true;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--suite") && i + 1 < argc)
+		{
+			++i;
+			micro = !strcmp(argv[i], "micro") || !strcmp(argv[i], "all");
+			macro = !strcmp(argv[i], "macro") || !strcmp(argv[i], "all");
+			if (!micro && !macro)
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "--cpus") && i + 1 < argc)
+			config.m_MaxCpus = TCLAMP((uint32)atoi(argv[++i]), 1u, Bench::GetCpuCount());
+		else if (!strcmp(argv[i], "--quick"))
+			config.m_Quick = true;
+		else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+			config.m_Filter = argv[++i];
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	Bench::Report report;
+	for (uint32 cpus : Bench::GetCpuSweep(config.m_MaxCpus))
+	{
+		if (!Bench::RestrictCpus(cpus) && cpus != config.m_MaxCpus)
+			continue;
+		printf("Running on %u CPU(s)...\n", cpus);
+		fflush(stdout);
+		if (micro)
+			Bench::RunMicroBenchmarks(config, cpus, report);
+		if (macro)
+			Bench::RunMacroBenchmarks(config, cpus, report);
+	}
+	report.Print();
+	return report.HasErrors() ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
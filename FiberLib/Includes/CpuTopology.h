@@ -0,0 +1,78 @@
+// CpuTopology.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include <string>
+#include <vector>
+
+
+// Where the workers go, NONE leaves the threads to the OS
+enum class AffinityPolicy : uint8
+{
+	NONE,
+	COMPACT,		// a CPU each, filling the SMT siblings of a core and then its L3 first
+	SCATTER,		// a CPU each, spread over the L3 domains and cores before sharing any core
+	ONE_PER_CORE	// all SMT siblings of a core each, one worker per core
+};
+
+
+// class CpuTopology
+//------------------------------------------------------------------------------
+// The CPUs the process may run on, with the core, L3 domain and NUMA node each
+// belongs to. On Linux it is read from sysfs, elsewhere or when that fails
+// every CPU is taken as a core of its own in a single domain.
+class CpuTopology
+{
+public:
+	struct CpuInfo
+	{
+		uint32 m_Cpu;
+		uint32 m_Core;		// dense indices, in the order the CPUs come
+		uint32 m_Thread;	// position among the SMT siblings of the core
+		uint32 m_L3;
+		uint32 m_Node;
+	};
+
+	enum Distance : uint32
+	{
+		SAME_CORE = 0,
+		SAME_L3,
+		SAME_NODE,
+		REMOTE
+	};
+
+	// Discovered once, restricted to the affinity the process started with
+	static const CpuTopology& Get();
+	// Every online CPU under root, like "/sys/devices/system"
+	static CpuTopology Load(const std::string& root);
+	static CpuTopology Flat(uint32 count);
+
+	FORCE_INLINE const std::vector<CpuInfo>& GetCpus() const { return m_Cpus; }
+	FORCE_INLINE uint32 GetCoreCount() const { return m_CoreCount; }
+	FORCE_INLINE uint32 GetL3Count() const { return m_L3Count; }
+	FORCE_INLINE uint32 GetNodeCount() const { return m_NodeCount; }
+
+	const CpuInfo* Find(uint32 cpu) const;
+	// CPUs unknown to the topology are taken as remote
+	Distance       GetDistance(uint32 cpuA, uint32 cpuB) const;
+	// The CPUs of each of count workers, wrapping around when there are more workers than room
+	std::vector<std::vector<uint32>> Place(AffinityPolicy policy, uint32 count) const;
+
+	// "0-3,8,10-11" as in sysfs
+	static std::vector<uint32> ParseCpuList(const std::string& text);
+
+private:
+	void Keep(const std::vector<uint32>& allowed);
+	void Finish();
+
+	std::vector<CpuInfo> m_Cpus;		// sorted by CPU number
+	uint32               m_CoreCount{ 0 };
+	uint32               m_L3Count{ 0 };
+	uint32               m_NodeCount{ 0 };
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
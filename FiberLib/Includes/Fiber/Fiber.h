@@ -13,9 +13,12 @@ namespace Fiber
 {
 	using FiberProc = void(*)(void*);
 	void* InitFromThread();
+	// Turns the thread back from a fiber, once it runs on the fiber InitFromThread returned
+	void  ReleaseFromThread();
 	void* CreateFiber(int stacksize, FiberProc proc, void* parameter);
 	void  DestroyFiber(void* fiber);
 	void  SwitchTo(void* fiber);
+	SIZET ReleaseUnusedStack(void* fiber);
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,306 @@
+// FiberChannel.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include "Fiber/FiberSync.h"
+#include <atomic>
+#include <new>
+#include <utility>
+
+
+// class ChannelBase
+//------------------------------------------------------------------------------
+// Waiting side of a channel. A sender or receiver that can't make progress
+// registers in its wait list and re-checks the ring before it parks, while the
+// other side looks at the waiter count after every transfer, so either the
+// waiter sees the free slot or item, or the other side sees the waiter.
+class ChannelBase
+{
+public:
+	ChannelBase() = default;
+	ChannelBase(const ChannelBase&) = delete;
+
+	// Resumes everybody waiting, sends fail from now on and receives once the channel is drained
+	void Close();
+	FORCE_INLINE bool IsClosed() const { return m_Closed.load(std::memory_order_acquire); }
+
+protected:
+	enum Side : uint32
+	{
+		SENDERS = 0,
+		RECEIVERS,
+		SIDE_COUNT
+	};
+
+	// Parks the fiber unless ready() or the channel closed in the meantime, the caller retries either way
+	template<class Ready>
+	void Wait(Side side, Ready&& ready)
+	{
+		WaitList& list = m_Waiters[side];
+		FiberWaiter waiter;
+		list.m_Queue.Lock();
+		list.m_Count.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (ready() || IsClosed())
+		{
+			list.m_Count.fetch_sub(1, std::memory_order_relaxed);
+			list.m_Queue.Unlock();
+			return;
+		}
+		list.m_Queue.Push(&waiter);
+		list.m_Queue.Unlock();
+		waiter.Suspend();
+	}
+
+	// Resumes up to count waiters of the side after count items or slots turned up
+	void Notify(Side side, uint32 count);
+
+private:
+	struct WaitList
+	{
+		FiberWaitQueue      m_Queue;
+		std::atomic<uint32> m_Count{ 0 };
+	};
+
+	WaitList          m_Waiters[SIDE_COUNT];
+	std::atomic<bool> m_Closed{ false };
+};
+
+
+// class Channel
+//------------------------------------------------------------------------------
+// Bounded MPMC channel on a ring of sequenced cells (Vyukov's bounded queue).
+// The Try calls never wait. Send on a full channel and Recv on an empty one
+// spin a little, then park the calling fiber until the other side made room
+// or an item, or the channel is closed. The batched calls wake the other side
+// once per batch instead of once per item. Items sent while another thread
+// closes the channel may still be delivered.
+template<class T>
+class Channel : public ChannelBase
+{
+public:
+	// Capacity is rounded up to a power of two, and is at least 2
+	explicit Channel(uint32 capacity)
+	{
+		SIZET size = 2;
+		while (size < capacity)
+			size <<= 1;
+		m_Mask = size - 1;
+		m_Cells = new Cell[size];
+		for (SIZET i = 0; i < size; ++i)
+			m_Cells[i].m_Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	~Channel()
+	{
+		SIZET end = m_EnqueuePos.load(std::memory_order_relaxed);
+		for (SIZET pos = m_DequeuePos.load(std::memory_order_relaxed); pos != end; ++pos)
+		{
+			Cell& cell = m_Cells[pos & m_Mask];
+			if (cell.m_Sequence.load(std::memory_order_relaxed) == pos + 1)
+				cell.GetItem()->~T();
+		}
+		delete[] m_Cells;
+	}
+
+	template<class U>
+	bool TrySend(U&& value)
+	{
+		if (IsClosed() || !Enqueue(std::forward<U>(value)))
+			return false;
+		Notify(RECEIVERS, 1);
+		return true;
+	}
+
+	bool TryRecv(T& value)
+	{
+		if (!Dequeue(value))
+			return false;
+		Notify(SENDERS, 1);
+		return true;
+	}
+
+	// False once the channel is closed, the value is left untouched then
+	template<class U>
+	bool Send(U&& value)
+	{
+		for (uint32 spin = 0;; ++spin)
+		{
+			if (IsClosed())
+				return false;
+			if (Enqueue(std::forward<U>(value)))
+			{
+				Notify(RECEIVERS, 1);
+				return true;
+			}
+			if (spin < FiberWaitQueue::SPIN_COUNT)
+				CpuPause();
+			else
+				Wait(SENDERS, [this]() { return !IsFull(); });
+		}
+	}
+
+	// False once the channel is closed and drained
+	bool Recv(T& value)
+	{
+		for (uint32 spin = 0;; ++spin)
+		{
+			if (Dequeue(value))
+			{
+				Notify(SENDERS, 1);
+				return true;
+			}
+			// Only trust an empty ring after the close, items sent before it are still delivered
+			if (IsClosed())
+				return TryRecv(value);
+			if (spin < FiberWaitQueue::SPIN_COUNT)
+				CpuPause();
+			else
+				Wait(RECEIVERS, [this]() { return !IsEmpty(); });
+		}
+	}
+
+	// Sends all of the values in order, less only when the channel was closed
+	uint32 SendN(const T* values, uint32 count)
+	{
+		uint32 sent = 0;
+		for (uint32 spin = 0; sent < count; ++spin)
+		{
+			if (IsClosed())
+				break;
+			uint32 batch = sent;
+			while (sent < count && Enqueue(values[sent]))
+				++sent;
+			if (sent != batch)
+			{
+				Notify(RECEIVERS, sent - batch);
+				spin = 0;
+			}
+			else if (spin < FiberWaitQueue::SPIN_COUNT)
+				CpuPause();
+			else
+				Wait(SENDERS, [this]() { return !IsFull(); });
+		}
+		return sent;
+	}
+
+	// Waits for at least one item and takes up to count without waiting, 0 once closed and drained
+	uint32 RecvN(T* values, uint32 count)
+	{
+		if (count == 0)
+			return 0;
+		for (uint32 spin = 0;; ++spin)
+		{
+			uint32 received = 0;
+			while (received < count && Dequeue(values[received]))
+				++received;
+			if (received != 0)
+			{
+				Notify(SENDERS, received);
+				return received;
+			}
+			if (IsClosed())
+			{
+				while (received < count && Dequeue(values[received]))
+					++received;
+				Notify(SENDERS, received);
+				return received;
+			}
+			if (spin < FiberWaitQueue::SPIN_COUNT)
+				CpuPause();
+			else
+				Wait(RECEIVERS, [this]() { return !IsEmpty(); });
+		}
+	}
+
+	FORCE_INLINE uint32 GetCapacity() const { return (uint32)(m_Mask + 1); }
+	// Approximate while other threads send or receive
+	FORCE_INLINE uint32 GetSize() const
+	{
+		SIZET dequeuePos = m_DequeuePos.load(std::memory_order_relaxed);
+		SIZET enqueuePos = m_EnqueuePos.load(std::memory_order_relaxed);
+		return enqueuePos > dequeuePos ? (uint32)(enqueuePos - dequeuePos) : 0;
+	}
+
+private:
+	// A cell is free for the sender at pos when its sequence is pos, and holds an item for the receiver at pos when it's pos + 1
+	struct Cell
+	{
+		std::atomic<SIZET>       m_Sequence;
+		alignas(T) unsigned char m_Storage[sizeof(T)];
+
+		FORCE_INLINE T* GetItem() { return std::launder(reinterpret_cast<T*>(m_Storage)); }
+	};
+
+	template<class U>
+	bool Enqueue(U&& value)
+	{
+		SIZET pos = m_EnqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = m_Cells[pos & m_Mask];
+			int64 diff = (int64)cell.m_Sequence.load(std::memory_order_acquire) - (int64)pos;
+			if (diff == 0)
+			{
+				if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					new (cell.m_Storage) T(std::forward<U>(value));
+					cell.m_Sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = m_EnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	bool Dequeue(T& value)
+	{
+		SIZET pos = m_DequeuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = m_Cells[pos & m_Mask];
+			int64 diff = (int64)cell.m_Sequence.load(std::memory_order_acquire) - (int64)(pos + 1);
+			if (diff == 0)
+			{
+				if (m_DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					T* item = cell.GetItem();
+					value = std::move(*item);
+					item->~T();
+					cell.m_Sequence.store(pos + m_Mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = m_DequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	bool IsFull() const
+	{
+		SIZET pos = m_EnqueuePos.load(std::memory_order_relaxed);
+		return (int64)m_Cells[pos & m_Mask].m_Sequence.load(std::memory_order_acquire) - (int64)pos < 0;
+	}
+
+	bool IsEmpty() const
+	{
+		SIZET pos = m_DequeuePos.load(std::memory_order_relaxed);
+		return (int64)m_Cells[pos & m_Mask].m_Sequence.load(std::memory_order_acquire) - (int64)(pos + 1) < 0;
+	}
+
+	Cell*                          m_Cells{ nullptr };
+	SIZET                          m_Mask{ 0 };
+	alignas(64) std::atomic<SIZET> m_EnqueuePos{ 0 };
+	alignas(64) std::atomic<SIZET> m_DequeuePos{ 0 };
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,175 @@
+// FiberIO.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include <atomic>
+#include <vector>
+
+class FiberDesc;
+struct sockaddr;
+
+
+// struct IoRequest
+//------------------------------------------------------------------------------
+// One operation in flight or socket wait, it lives on the stack of the fiber
+// waiting for it.
+struct IoRequest
+{
+	IoRequest* m_Next{ nullptr };
+	FiberDesc* m_Fiber{ nullptr };
+	int32      m_Result{ 0 };
+};
+
+
+// class IoRing
+//------------------------------------------------------------------------------
+// io_uring of one worker, set up with raw syscalls on Linux. Operations are
+// queued in the submission ring and handed to the kernel in batches, once
+// SUBMIT_BATCH are queued, SUBMIT_INTERVAL submit calls have passed since the
+// last one or the worker runs out of other work, so one worker keeps hundreds
+// of operations in flight for a few syscalls. Completions are read straight
+// from the shared ring without entering the kernel. A parked worker waits for
+// them in its Reactor, which watches the ring descriptor.
+//
+// Only the owner thread queues, submits and reaps.
+class IoRing
+{
+public:
+	static constexpr uint32 ENTRY_COUNT = 256;
+	static constexpr uint32 SUBMIT_BATCH = 32;
+	static constexpr uint32 SUBMIT_INTERVAL = 32;
+
+	IoRing();
+	~IoRing();
+
+	IoRing(const IoRing&) = delete;
+
+	bool       Init(uint32 entries = ENTRY_COUNT);
+	// Queues an operation, false when as many are in flight as the completion ring holds
+	bool       Queue(IoRequest* request, uint8 opcode, int32 fd, const void* addr, uint32 len, uint64 offset, uint32 flags = 0);
+	void       Submit(bool flush);
+	// Completed requests in completion order, linked through m_Next
+	IoRequest* Reap();
+
+	FORCE_INLINE int32 GetFd() const { return m_Fd; }
+	FORCE_INLINE bool IsValid() const { return m_Fd >= 0; }
+	FORCE_INLINE bool IsBusy() const { return m_InFlight != 0; }
+	bool              HasCompletions() const;
+
+private:
+	void*  NextEntry();
+	int32  Enter(uint32 submit);
+
+	int32   m_Fd;
+	uint32  m_Features;
+	void*   m_SqRing;
+	void*   m_CqRing;
+	void*   m_Entries;
+	SIZET   m_SqRingSize;
+	SIZET   m_CqRingSize;
+	SIZET   m_EntriesSize;
+	uint32* m_SqTail;
+	uint32* m_SqHead;
+	uint32  m_SqMask;
+	uint32  m_SqCount;
+	uint32* m_CqHead;
+	uint32* m_CqTail;
+	uint32  m_CqMask;
+	uint32  m_CqCount;
+	void*   m_Completions;
+	uint32  m_Tail;				// next free submission entry, published to the kernel on Submit
+	uint32  m_Queued;			// queued and not submitted yet
+	uint32  m_InFlight;			// requests queued or submitted without a completion
+	uint32  m_Tick;				// submit calls that left requests queued
+};
+
+
+// class Reactor
+//------------------------------------------------------------------------------
+// epoll set of one worker. A fiber whose socket call would block waits for
+// the socket here, registered edge triggered for both directions, and its
+// worker resumes it once the socket turns ready. A busy worker checks the set
+// every POLL_INTERVAL loops and before going idle, a parked one sleeps in it
+// together with its io_uring and an eventfd other threads signal to wake it.
+//
+// Only the owner thread watches and polls, other threads may only Interrupt.
+class Reactor
+{
+public:
+	static constexpr uint32 POLL_INTERVAL = 32;
+	static constexpr uint32 EVENT_COUNT = 128;
+
+	Reactor();
+	~Reactor();
+
+	Reactor(const Reactor&) = delete;
+
+	bool       Init();
+	void       WatchRing(int32 ringFd);
+	// Parks the request until the socket turns ready, false when epoll can't watch it
+	bool       Watch(int32 fd, bool write, IoRequest* request);
+	// The descriptor is being closed, its waiters are resumed to see the error
+	void       Forget(int32 fd);
+	// Requests whose socket turned ready, linked through m_Next. The set is only
+	// checked when asked to or once every POLL_INTERVAL calls.
+	IoRequest* Poll(bool check);
+	// Sleeps until a socket or the ring is ready, an Interrupt or the timeout, 0 waits without timeout
+	void       Wait(uint64 timeUS);
+	void       Interrupt();
+
+	FORCE_INLINE bool IsValid() const { return m_Fd >= 0; }
+	FORCE_INLINE bool IsBusy() const { return m_Waiting != 0 || m_Ready != nullptr; }
+	FORCE_INLINE bool HasReady() const { return m_Ready != nullptr; }
+
+private:
+	struct Waiters
+	{
+		IoRequest* m_Readers{ nullptr };
+		IoRequest* m_Writers{ nullptr };
+		bool       m_Registered{ false };
+	};
+
+	void Check(int32 timeoutMS, uint64 timeUS);
+	void Resume(IoRequest*& list);
+
+	int32                m_Fd;
+	int32                m_WakeFd;
+	int32                m_RingFd;
+	uint32               m_Waiting;
+	uint32               m_Tick;
+	IoRequest*           m_Ready;
+	IoRequest*           m_ReadyTail;
+	std::vector<Waiters> m_Sockets;		// by descriptor
+};
+
+
+// namespace FiberIO
+//------------------------------------------------------------------------------
+// I/O that suspends the calling fiber instead of its worker thread, the worker
+// runs other fibers until the operation resumes it on the same worker. File
+// operations go to the worker's ring, socket calls wait in its reactor when
+// they would block. Results follow the syscalls, a count or descriptor on
+// success and -errno on failure. Called outside of a fiber job, or where
+// io_uring and epoll are not available, they block like the syscall.
+//
+// Sockets must be non-blocking, Socket and Accept return them that way.
+namespace FiberIO
+{
+	int32 OpenAt(int32 dirFd, const char* path, int32 flags, uint32 mode = 0);
+	int32 Read(int32 fd, void* buffer, uint32 size, uint64 offset);
+	int32 Write(int32 fd, const void* buffer, uint32 size, uint64 offset);
+	int32 Fsync(int32 fd, bool dataOnly = false);
+	int32 Close(int32 fd);
+
+	int32 Socket(int32 domain, int32 type, int32 protocol = 0);
+	int32 Accept(int32 fd, sockaddr* addr = nullptr, uint32* addrLen = nullptr);
+	int32 Connect(int32 fd, const sockaddr* addr, uint32 addrLen);
+	int32 Recv(int32 fd, void* buffer, uint32 size, int32 flags = 0);
+	int32 Send(int32 fd, const void* buffer, uint32 size, int32 flags = 0);
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
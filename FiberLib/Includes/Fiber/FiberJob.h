@@ -7,18 +7,69 @@
 #include "Types.h"
 #include "Job.h"
 #include "Worker.h"
+#include "Fiber/TimerWheel.h"
+#include <memory>
 #include <memory_resource>
 #include <chrono>
+#include <vector>
 
 
 class FiberWorker;
 class JobSignal;
 class FiberJob;
 class FiberScheduler;
+class JobRecord;
+class JobPool;
+
+
+
+// class JobHandle
+//------------------------------------------------------------------------------
+// Handle to a pooled JobRecord, made of the record and the generation it was
+// taken at. Copies hold the record so user code never sees it recycled, the
+// scheduler itself passes raw records around and never touches the holds.
+template<class T>
+class JobHandle
+{
+public:
+	JobHandle() = default;
+	JobHandle(std::nullptr_t) {}
+	explicit JobHandle(JobRecord* record);
+	JobHandle(const JobHandle& other);
+	JobHandle(JobHandle&& other) noexcept;
+	~JobHandle();
+
+	JobHandle& operator=(JobHandle other) noexcept;
+
+	static JobHandle Adopt(JobRecord* record);
+
+	T*   get() const;
+	T*   operator->() const { return get(); }
+	explicit operator bool() const { return m_Record != nullptr; }
+	bool operator==(const JobHandle& other) const { return m_Record == other.m_Record && m_Generation == other.m_Generation; }
+	bool operator!=(const JobHandle& other) const { return !(*this == other); }
+
+private:
+	JobRecord* m_Record{ nullptr };
+	uint32     m_Generation{ 0 };
+};
+
+using JobSignalPtr = JobHandle<JobSignal>;
+using FiberJobPtr = JobHandle<FiberJob>;
+
+
+// struct JobSignalNode
+//------------------------------------------------------------------------------
+// Entry of a signal's successor list, either a job to push or a signal to
+// trigger once the signal fires.
+struct JobSignalNode
+{
+	JobSignalNode*    m_Next{ nullptr };
+	FiberJob*         m_Job{ nullptr };
+	JobSignal*        m_Trigger{ nullptr };
+	std::atomic<bool> m_Used{ false };
+};
 
-using JobSignalPtr = std::shared_ptr<JobSignal>;
-using FiberJobPtr = std::shared_ptr<FiberJob>;
-using TimerMS = std::chrono::milliseconds;
 
 // class FiberJob
 //------------------------------------------------------------------------------
@@ -26,19 +77,28 @@ class FiberJob
 {
 public:
 	FiberJob();
-	FiberJob(FiberScheduler* sche);
-	FiberJob(FiberScheduler* sche, std::shared_ptr<Job> job);
 	~FiberJob();
 
-	FORCE_INLINE JobSignalPtr         GetSignal() const { return m_JobSignal; }
-	FORCE_INLINE FiberScheduler*      GetScheduler() const { return m_Scheduler; }
-	FORCE_INLINE uint32               GetWorkerID() const { return m_WorkerID; }
-	FORCE_INLINE uint64               GetWorkerFilter() const { return m_WorkerFilter; }
-	FORCE_INLINE std::shared_ptr<Job> GetJob() const { return m_Job; }
+	FiberJob(const FiberJob&) = delete;
+
+	JobSignalPtr                 GetSignal() const;
+	FORCE_INLINE FiberScheduler* GetScheduler() const { return m_Scheduler; }
+	FORCE_INLINE uint32          GetWorkerID() const { return m_WorkerID; }
+	FORCE_INLINE uint64          GetWorkerFilter() const { return m_WorkerFilter; }
+	FORCE_INLINE Job*            GetJob() const { return m_Job; }
+	// Tells apart every use of the record, for traces
+	uint64                       GetID() const;
 
-	FORCE_INLINE void StartCounter() { m_TimeStamp = std::chrono::duration_cast<TimerMS>(std::chrono::steady_clock::now().time_since_epoch()); }
-	FORCE_INLINE bool IsTimeout() const { return m_HoldTime == 0 ? false : m_TimeStamp.count() > m_HoldTime; }
-	FORCE_INLINE void SetMaxPeriod(uint32 period) { m_HoldTime = period; }
+	// A job with a max period must start within that many milliseconds of being posted, or of its
+	// timer firing. It is run earliest deadline first and dropped as expired once it can't make it.
+	void              StartCounter();
+	FORCE_INLINE bool HasDeadline() const { return m_DeadlineUS != 0; }
+	FORCE_INLINE bool IsTimeout() const { return m_DeadlineUS != 0 && TimerWheel::Now() >= m_DeadlineUS; }
+	FORCE_INLINE void SetMaxPeriod(uint32 periodMS) { m_DeadlineUS = periodMS ? m_ReadyUS + (uint64)periodMS * 1000 : 0; }
+	FORCE_INLINE uint64 GetDeadline() const { return m_DeadlineUS; }
+	FORCE_INLINE uint64 GetReadyTime() const { return m_ReadyNS; }
+	// Recurring jobs run again every period until they fail or their Job is aborted
+	FORCE_INLINE bool IsRecurring() const { return m_PeriodUS != 0; }
 
 	FORCE_INLINE void SetStatus(Job::Status status) { m_Job->SetStatus(status); }
 	FORCE_INLINE void SetPreResult(int32 result) { m_Job->SetPreResult(result); }
@@ -53,62 +113,174 @@ public:
 	FiberJobPtr PostCompletor(Functor&& job);
 
 private:
-	std::shared_ptr<Job> m_Job;
-	JobSignalPtr         m_JobSignal;
+	// Function jobs are built in the record, other jobs are shared with the caller
+	static constexpr SIZET INLINE_JOB_SIZE = TMAX(sizeof(FuncJob), sizeof(FuncCompletorJob));
+
+	JobSignal* GetJobSignal() const;
+	void       SetJob(std::shared_ptr<Job> job);
+	template<class JobType, class Functor>
+	void       EmplaceJob(Functor&& func);
+	void       Reset();
+
+	Job*                 m_Job;
+	std::shared_ptr<Job> m_SharedJob;
+	JobRecord*           m_Record;
 	uint32               m_WorkerID;
 	uint64               m_WorkerFilter;
 	FiberScheduler*      m_Scheduler;
-	TimerMS              m_TimeStamp;
-	uint32               m_HoldTime;
+	uint64               m_ReadyNS;		// posted or its timer fired
+	uint64               m_ReadyUS;
+	uint64               m_DeadlineUS;
+	uint64               m_PeriodUS;
+	JobSignalNode        m_SignalNode;		// a job waits on one signal at most
+	TimerNode            m_TimerNode;		// or on one timer
+	alignas(std::max_align_t) unsigned char m_InlineJob[INLINE_JOB_SIZE];
 
 	friend class FiberScheduler;
 	friend class JobSignal;
+	friend class JobPool;
 };
 
-template<class Functor>
-FiberJobPtr FiberJob::PostSuccessor(Functor&& func, uint64 worker)
+template<class JobType, class Functor>
+void FiberJob::EmplaceJob(Functor&& func)
 {
-	std::shared_ptr<Job> job = std::allocate_shared<FuncJob>(m_Scheduler->GetJobAllocator(), std::forward<Functor>(func));
-	return PostSuccessor(job, worker);
+	static_assert(sizeof(JobType) <= INLINE_JOB_SIZE, "job type doesn't fit the record");
+	m_Job = new (m_InlineJob) JobType(std::forward<Functor>(func));
 }
 
-template<class Functor>
-FiberJobPtr FiberJob::PostCompletor(Functor&& func)
-{
-	std::shared_ptr<Job> job = std::allocate_shared<FuncCompletorJob>(m_Scheduler->GetJobAllocator(), std::forward<Functor>(func));
-	return PostCompletor(job);
-}
-
-using FiberJobAllocator = std::pmr::polymorphic_allocator<FiberJob>;
-
 
 // class JobSignal
 //------------------------------------------------------------------------------
+// Counts the triggers it still waits for. Successors are pushed on a lock free
+// list which the trigger reaching zero swaps for a closed marker, so adding a
+// successor to a fired signal fails and the caller runs it right away.
+// Successor signals use the inline nodes first and heap nodes past them.
 class JobSignal
 {
 public:
+	static constexpr uint32 INLINE_NODES = 3;
+
 	JobSignal();
-	JobSignal(FiberScheduler* scheduler);
 
-	void Trigger(int32 result);	
-	void AddTrigger(JobSignalPtr signal, bool inc = true);
+	JobSignal(const JobSignal&) = delete;
+
+	void Trigger(int32 result);
+	void AddTrigger(JobSignal* signal, bool inc = true);
 
 private:
-	bool IsValid();
-	void PushJob(FiberJobPtr job, bool lock);
+	bool IsValid() const;
+	void Arm(int32 count = 1);
+	bool PushJob(FiberJob* job);
+	bool PushNode(JobSignalNode* node);
+	void Reset();
 
-	FiberScheduler*           m_Scheduler;
-	std::vector<FiberJobPtr>  m_NextJobs;
-	std::atomic<int32>        m_RefCount;
-	std::vector<JobSignalPtr> m_Triggers;
-	std::mutex                m_Mutex;
+	JobSignalNode* AcquireNode();
+	void           ReleaseNode(JobSignalNode* node);
+
+	FiberScheduler*             m_Scheduler;
+	JobRecord*                  m_Record;
+	std::atomic<int32>          m_RefCount;
+	std::atomic<int32>          m_Result;
+	std::atomic<JobSignalNode*> m_Successors;
+	JobSignalNode               m_InlineNodes[INLINE_NODES];
 
 	friend class FiberJob;
 	friend class FiberScheduler;
+	friend class JobPool;
+	friend class TaskPromiseBase;
+	friend class JobEpoch;
+	friend struct SignalAwaiter;
+};
+
+
+// class JobRecord
+//------------------------------------------------------------------------------
+// A pooled job and its completion signal, a standalone signal only uses the
+// second half. The record lives while user handles hold it or while its signal
+// is armed, i.e. the job has not run yet or preconditions are still pending.
+class JobRecord
+{
+public:
+	FORCE_INLINE void AddHold() { m_Holds.fetch_add(1, std::memory_order_relaxed); }
+	void              ReleaseHold();
+
+	FiberJob            m_Job;
+	JobSignal           m_Signal;
+	std::atomic<uint32> m_Holds{ 0 };
+	uint32              m_Generation{ 0 };
+	uint32              m_Index{ 0 };
+	std::atomic<uint32> m_NextFree{ 0 };
+	JobPool*            m_Pool{ nullptr };
 };
 
-using JobSignalAllocator = std::pmr::polymorphic_allocator<JobSignal>;
 
+FORCE_INLINE uint64 FiberJob::GetID() const
+{
+	return (uint64)m_Record->m_Generation << 32 | m_Record->m_Index;
+}
+
+template<class T>
+JobHandle<T>::JobHandle(JobRecord* record)
+	: m_Record(record)
+	, m_Generation(record ? record->m_Generation : 0)
+{
+	if (m_Record)
+		m_Record->AddHold();
+}
+
+template<class T>
+JobHandle<T>::JobHandle(const JobHandle& other)
+	: m_Record(other.m_Record)
+	, m_Generation(other.m_Generation)
+{
+	if (m_Record)
+		m_Record->AddHold();
+}
+
+template<class T>
+JobHandle<T>::JobHandle(JobHandle&& other) noexcept
+	: m_Record(other.m_Record)
+	, m_Generation(other.m_Generation)
+{
+	other.m_Record = nullptr;
+}
+
+template<class T>
+JobHandle<T>::~JobHandle()
+{
+	if (m_Record)
+		m_Record->ReleaseHold();
+}
+
+template<class T>
+JobHandle<T>& JobHandle<T>::operator=(JobHandle other) noexcept
+{
+	std::swap(m_Record, other.m_Record);
+	std::swap(m_Generation, other.m_Generation);
+	return *this;
+}
+
+template<class T>
+/*static*/ JobHandle<T> JobHandle<T>::Adopt(JobRecord* record)
+{
+	// Takes over a hold the caller already counted
+	JobHandle handle;
+	handle.m_Record = record;
+	handle.m_Generation = record->m_Generation;
+	return handle;
+}
+
+template<class T>
+T* JobHandle<T>::get() const
+{
+	if (!m_Record)
+		return nullptr;
+	ASSERT(m_Record->m_Generation == m_Generation);
+	if constexpr (std::is_same<T, FiberJob>::value)
+		return &m_Record->m_Job;
+	else
+		return &m_Record->m_Signal;
+}
 
 
 // class FiberDesc
@@ -116,17 +288,15 @@ using JobSignalAllocator = std::pmr::polymorphic_allocator<JobSignal>;
 class FiberDesc
 {
 public:
-	FORCE_INLINE int32 GetRemainTime() const { return (int32)(m_LoopMS - m_StartMS.count()); }
-	FORCE_INLINE void  StartCounter() { m_StartMS = std::chrono::duration_cast<TimerMS>(std::chrono::steady_clock::now().time_since_epoch()); }
-
 	void*           m_Fiber{ nullptr };
 	FiberScheduler* m_Scheduler{ nullptr };
-	FiberJobPtr     m_CurrentJob;
-	TimerMS         m_StartMS;
-	uint32          m_LoopMS{ 0 };
+	FiberJob*       m_CurrentJob{ nullptr };
+	TimerNode       m_TimerNode;		// wakes the fiber up from YieldPoll
+	uint8           m_StackSize{ 0 };
+	bool            m_StackReleased{ false };
 };
 
 using FiberDescAllocator = std::pmr::polymorphic_allocator<FiberDesc>;
 
 
-//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,100 @@
+// FiberJobQueue.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include "Fiber/FiberJob.h"
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+
+
+// class FiberJobQueue
+//------------------------------------------------------------------------------
+// Ready jobs indexed by priority and worker filter. Every distinct filter mask
+// in use gets one of 64 slots, kept while it runs empty until a new filter
+// needs it; occupancy is kept as a slot bitmap per priority so a worker finds
+// its highest priority eligible job with a bit scan over the priorities and
+// one over the slots.
+//
+// Push/Pop must be called with the owner's lock held, HasJob is lock free.
+class FiberJobQueue
+{
+public:
+	static constexpr uint32 SLOT_COUNT = 64;
+	static constexpr uint32 PRIO_COUNT = (uint32)Job::Priority::PRIO_MAX;
+
+	FiberJobQueue();
+
+	void        Push(FiberJob* job);
+	FiberJob*   Pop(uint64 workerFilter);
+	void        Clear();
+
+	FORCE_INLINE bool HasJob(uint64 workerFilter) const
+	{
+		return (m_OccupiedSlots.load(std::memory_order_acquire) & GetEligibleSlots(workerFilter)) != 0
+			|| (m_OverflowWorkers.load(std::memory_order_acquire) & workerFilter) != 0;
+	}
+
+private:
+	uint64 GetEligibleSlots(uint64 workerFilter) const;
+	int32  AcquireSlot(uint64 workerFilter);
+	void   ReleaseSlot(uint32 slot);
+	void   FreeSlot(uint32 slot);
+	void   AddOverflow(uint64 workerFilter);
+	void   RemoveOverflow(uint64 workerFilter);
+
+	std::vector<FiberJob*>             m_Jobs[PRIO_COUNT][SLOT_COUNT];
+	uint32                             m_SlotJobCount[SLOT_COUNT];
+	uint64                             m_SlotFilters[SLOT_COUNT];
+	uint64                             m_UsedSlots;
+	std::unordered_map<uint64, uint32> m_FilterSlots;
+
+	std::atomic<uint64>                m_WorkerSlots[64];			// slots a worker may run, by worker id
+	std::atomic<uint64>                m_PrioSlots[PRIO_COUNT];		// non-empty slots, by priority
+	std::atomic<uint64>                m_OccupiedSlots;				// non-empty slots at any priority
+	std::atomic<uint32>                m_OccupiedPrios;				// priorities with a non-empty slot
+
+	// Only used while 64 other filters all have jobs queued
+	std::vector<FiberJob*>             m_Overflow;
+	uint32                             m_OverflowJobs[64];			// overflow jobs each worker may run, by worker id
+	std::atomic<uint64>                m_OverflowWorkers;			// workers with an overflow job they may run
+};
+
+
+// class DeadlineJobQueue
+//------------------------------------------------------------------------------
+// Ready jobs with a deadline, as a binary heap on the deadline so workers run
+// them earliest deadline first. Pop hands out a job past its deadline before
+// anything else, whatever its filter, so the caller can drop it; otherwise the
+// earliest job the worker may run.
+//
+// Push/Pop must be called with the owner's lock held, HasJob is lock free.
+class DeadlineJobQueue
+{
+public:
+	DeadlineJobQueue();
+
+	void        SetWorkerMask(uint64 workerMask) { m_WorkerMask = workerMask; }
+	void        Push(FiberJob* job);
+	FiberJob*   Pop(uint64 workerFilter, uint64 nowUS);
+	void        Clear();
+
+	FORCE_INLINE bool HasJob(uint64 workerFilter) const
+	{
+		return (m_EligibleWorkers.load(std::memory_order_acquire) & workerFilter) != 0;
+	}
+
+private:
+	FiberJob* Remove(SIZET index);
+
+	std::vector<FiberJob*> m_Heap;
+	uint32                 m_WorkerJobs[64];			// queued jobs each worker may run, by worker id
+	uint64                 m_WorkerMask;
+	std::atomic<uint64>    m_EligibleWorkers;			// workers with a queued job they may run
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
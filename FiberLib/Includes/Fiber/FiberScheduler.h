@@ -7,15 +7,24 @@
 #include "Types.h"
 #include "Misc.h"
 #include "Fiber/FiberJob.h"
+#include "Fiber/FiberJobQueue.h"
+#include "Fiber/JobPool.h"
+#include "Fiber/PoolResource.h"
+#include "Fiber/FiberWorker.h"
 #include "Worker.h"
-#include <map>
+#include "CpuTopology.h"
 #include <array>
+#include <deque>
+#include <type_traits>
 
 
 class FiberWorker;
 class FiberJob;
 class JobSignal;
 class FiberDesc;
+struct ScheduleAwaiter;
+class JobEpoch;
+class EpochScope;
 
 
 // class FiberScheduler
@@ -24,86 +33,453 @@ class FiberScheduler
 {
 public:
 	using WorkersArray  = std::vector<FiberWorker*>;
-	using PrioJobsArray = std::vector<std::vector<FiberJobPtr>>;
-	using JobPool       = std::map<uint64, PrioJobsArray>;
 	using ReadyFibers   = std::vector<std::vector<FiberDesc*>>;
-	using LoopFibers    = std::vector<FiberDesc*>;
-	using PendingJobs   = std::vector<std::vector<FiberJobPtr>>;
+	using PendingJobs   = std::vector<std::vector<FiberJob*>>;
+	using FreeFibers    = std::vector<FiberDesc*>;
 
 	FiberScheduler();
 	~FiberScheduler();
 
 	void InitWorker(uint8 count = 1);
+	// Where InitWorker pins the workers, and so which of them steal from each other first
+	void SetAffinityPolicy(AffinityPolicy policy);
 	void ShutDown();
 
+	void  SetStackSize(Job::StackSize size, uint32 bytes);
+	void  SetDefaultStackSize(Job::StackSize size);
+	// The size class the job runs with, STACK_DEFAULT resolved to the default one
+	uint8 GetStackSize(const Job* job) const;
+	void  SetIdleStackLimit(uint32 count);
+	SIZET ReleaseIdleStacks();
+
+	// Workers pick a new policy up on their next idle step
+	void      SetIdlePolicy(const IdlePolicy& policy);
+	void      SetIdlePolicy(IdlePolicy::Preset preset);
+	IdleStats GetIdleStats() const;
+	// Counters and latency histograms summed over the workers, taken while they keep running
+	SchedulerStats GetStats() const;
+
 	FiberJobPtr  PostJob(std::shared_ptr<Job> job, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
-	FiberJobPtr  PostJob(std::shared_ptr<Job> job, JobSignalPtr signal, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	FiberJobPtr  PostJob(std::shared_ptr<Job> job, const JobSignalPtr& signal, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
 	template<class Functor>
 	FiberJobPtr  PostJob(Functor&& func, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
 	template<class Functor>
-	FiberJobPtr  PostJob(Functor&& func, JobSignalPtr signal, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
-	void         YieldFor(JobSignalPtr signal);
+	FiberJobPtr  PostJob(Functor&& func, const JobSignalPtr& signal, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	// Timed jobs wait on the wheel of the posting worker, or of the first worker of the filter when
+	// posted from elsewhere. A recurring job keeps its record and signal, which fires once it stops.
+	template<class Element>
+	FiberJobPtr  PostJobAfter(Element&& job, TimerUS delay, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	template<class Element>
+	FiberJobPtr  PostJobAt(Element&& job, std::chrono::steady_clock::time_point deadline, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	template<class Element>
+	FiberJobPtr  PostJobEvery(Element&& job, TimerUS period, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	// The job is dropped as expired if no worker starts it before the deadline
+	template<class Element>
+	FiberJobPtr  PostJobBefore(Element&& job, std::chrono::steady_clock::time_point deadline, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	template<class Iterator>
+	std::vector<FiberJobPtr> PostJobs(Iterator first, Iterator last, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	template<class Iterator>
+	JobSignalPtr PostBatch(Iterator first, Iterator last, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	void         YieldFor(const JobSignalPtr& signal);
+	// co_await in a Task to continue on a worker of the filter, defined in FiberTask.h
+	ScheduleAwaiter Schedule(uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	// Opens a scope for a transient job graph whose captures come from per-worker arenas, defined in JobEpoch.h
+	EpochScope   BeginEpoch();
 	void         YieldPoll(uint32 intervalMS);
-	void         WakeUpWorkers(uint64 workerFilter);
+	void         YieldPoll(TimerUS interval);
+	// Switches the worker to another fiber, whoever suspends must arrange for the current one to be resumed
+	void         SuspendFiber();
+	void         WakeUpWorkers(uint64 workerFilter, uint32 count = 1);
 
 	FiberDesc*   FetchFiber(bool lock = true);
+	FiberDesc*   FetchFiber(uint8 stackSize, bool lock = true);
 	void         FreeFiber(FiberDesc* fiber, bool lock = true);
+	void         FreeDeferredFiber();
+	// Frees a fiber for good instead of pooling it, for one that must never be resumed
+	void         DestroyFiber(FiberDesc* fiber);
 	JobSignalPtr FetchSignal();
 
-	void AddPreCondition(JobSignalPtr signal, JobSignalPtr condition);	
+	void AddPreCondition(const JobSignalPtr& signal, const JobSignalPtr& condition);
+
+	// Data parallel loops over [begin, end), to be called from a job. The range is split lazily
+	// in halves whenever the workers that could take the other half have nothing queued, and
+	// every piece runs on a worker of the filter. A body takes (index) or (begin, end).
+	template<class Body>
+	void ParallelFor(SIZET begin, SIZET end, SIZET grain, Body&& body, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	// body(begin, end, T value) -> T folds a piece, join(T left, T right) -> T must be associative
+	template<class T, class Body, class Join>
+	T    ParallelReduce(SIZET begin, SIZET end, SIZET grain, T identity, Body&& body, Join&& join, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	// body(begin, end, T prefix, bool final) -> T scans a piece from prefix, writing results only when final
+	template<class T, class Body, class Join>
+	T    ParallelScan(SIZET begin, SIZET end, SIZET grain, T identity, Body&& body, Join&& join, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
 
 	static void Poll(void* data);
 
 public:
-	void         PushJob(FiberJobPtr fiberJob, bool lock = true);
-	FiberJobPtr  PopJob(uint64 workerFilter);
+	void         PushJob(FiberJob* fiberJob, bool lock = true);
+	void         PushJobs(FiberJob** fiberJobs, SIZET count);
+	FiberJob*    PopJob(uint64 workerFilter);
 	FiberDesc*   PopFiber(uint32 workerID);
-	FiberDesc*   PopLoopFiber(uint32 workerID, int32& remainMS);
+	FiberDesc*   PopTimerFiber(FiberWorker* worker, uint64& remainUS);
+	FiberDesc*   PopIoFiber(FiberWorker* worker, bool flush);
+	void         PushReadyFiber(FiberDesc* fiber, uint32 workerID);
 	FiberWorker* GetWorkerByID(uint32 id);
 
-	bool         HasJobReady(uint64 workerFilter, bool lock = true);
-	FiberJobPtr  PopPendingJob(uint32 workerFilter);
+	bool         HasJobReady(uint64 workerFilter);
+	void         ParkWorker(FiberWorker* worker, uint64 timeUS);
+	uint64       GetParkedWorkers() const { return m_ParkedWorkers.load(std::memory_order_relaxed); }
+	bool         IsStarving(uint64 workerFilter);
+	bool         IsWorkerOf(uint64 workerFilter) const;
+	FiberJob*    PopPendingJob(uint32 workerFilter);
 
-	FiberJobAllocator&  GetJobAllocator() { return m_JobAllocator; }
 	FiberDescAllocator& GetDescAllocator() { return m_FiberAllocator; }
-	JobSignalAllocator& GetSignalAllocator() { return m_SignalAllocator; }
+	const JobPool&      GetJobPool() const { return m_JobPool; }
+	const PoolResource& GetPoolResource() const { return m_PoolResource; }
+	std::pmr::memory_resource* GetFrameResource() const { return m_FiberAllocator.resource(); }
 
 	std::mutex m_Lock;
 	std::mutex m_JobLock;
 
 private:
-	FiberJobPtr  _PostJob(std::shared_ptr<Job> job, uint64 worker, bool lock);
-	FiberJobPtr  _PostJob(std::shared_ptr<Job> job, JobSignalPtr signal, uint64 worker, bool lock);
+	void         _InitJob(JobRecord* record, uint64 worker);
+	FiberJobPtr  _PostJob(JobRecord* record, JobSignal* signal, uint64 worker, bool lock);
+	FiberJobPtr  _PostTimedJob(JobRecord* record, uint64 deadlineUS, uint64 periodUS, uint64 worker);
+	void         _AddTimer(TimerNode* node, uint64 workerFilter);
+	void         _RepeatJob(FiberJob* fiberJob);
+	void         _FinishJob(FiberJob* fiberJob, int32 result);
+	template<class JobType, class Functor>
+	FiberJobPtr  _PostFuncJob(Functor&& func, JobSignal* signal, uint64 worker);
+	template<class Element>
+	void         _SetJob(JobRecord* record, Element&& element);
+
+	template<class Body>
+	struct ParallelForContext
+	{
+		Body*      m_Body;
+		JobSignal* m_Signal;
+		SIZET      m_Grain;
+		uint64     m_Worker;
+	};
+	template<class T, class Body, class Join>
+	struct ParallelReduceContext
+	{
+		Body*  m_Body;
+		Join*  m_Join;
+		T      m_Identity;
+		SIZET  m_Grain;
+		uint64 m_Worker;
+	};
+
+	template<class Body>
+	void         _ParallelFor(ParallelForContext<Body>* context, SIZET begin, SIZET end);
+	template<class T, class Body, class Join>
+	T            _ParallelReduce(ParallelReduceContext<T, Body, Join>* context, SIZET begin, SIZET end);
 	void         _PushJobPending(int32 count, uint64 workerFilter);
 
+	bool         IsStealable(FiberWorker* worker, uint64 workerFilter) const;
+	FiberJob*    PopReadyJob(uint64 workerFilter);
+	FiberJob*    PopSharedJob(uint64 workerFilter);
+	FiberJob*    PopDeadlineJob(uint64 workerFilter);
+	FiberJob*    StealJob(FiberWorker* thief);
+	void         _InitStealOrder();
+
 	WorkersArray        m_Workers;
 	ReadyFibers         m_ReadyFibers;
-	LoopFibers          m_LoopFibers;
-	JobPool             m_Jobs;
+	FiberJobQueue       m_Jobs;
+	DeadlineJobQueue    m_DeadlineJobs;
 	PendingJobs         m_PendingJobs;
+	uint64              m_StealMask{ 0 };
+	uint64              m_WorkerMask{ 0 };
+	std::atomic<uint64> m_ParkedWorkers{ 0 };		// idle workers waiting for a wakeup, by filter bit
 
-	std::vector<FiberDesc*> m_FreeFibers;
-	FiberJobAllocator   m_JobAllocator;
+	FreeFibers          m_FreeFibers[(int)Job::StackSize::STACK_MAX];
+	std::vector<JobEpoch*> m_FreeEpochs;		// reset epochs, they keep their arenas
+	uint32              m_StackSizes[(int)Job::StackSize::STACK_MAX]{ 16 * KILOBYTE, 64 * KILOBYTE, 1 * MEGABYTE };
+	uint8               m_DefaultStackSize{ (uint8)Job::StackSize::STACK_MEDIUM };
+	uint32              m_IdleStackLimit{ 16 };
+	std::atomic<IdlePolicy> m_IdlePolicy{ IdlePolicy() };
+	AffinityPolicy      m_AffinityPolicy{ AffinityPolicy::NONE };
+	JobPool             m_JobPool;
+	PoolResource        m_PoolResource;		// fiber descriptors and task frames, a cache per worker
 	FiberDescAllocator  m_FiberAllocator;
-	JobSignalAllocator  m_SignalAllocator;
 
 	friend class FiberWorker;
 	friend class FiberJob;
+	friend class JobEpoch;
 };
 
 
 template<class Functor>
 FiberJobPtr FiberScheduler::PostJob(Functor&& func, uint64 worker)
 {
-	std::shared_ptr<Job> job = std::allocate_shared<FuncJob>(m_JobAllocator, std::forward<Functor>(func));
-	return PostJob(job, worker);
+	return _PostFuncJob<FuncJob>(std::forward<Functor>(func), nullptr, worker);
+}
+
+template<class Functor>
+FiberJobPtr FiberScheduler::PostJob(Functor&& func, const JobSignalPtr& signal, uint64 worker)
+{
+	return _PostFuncJob<FuncJob>(std::forward<Functor>(func), signal.get(), worker);
+}
+
+template<class Element>
+FiberJobPtr FiberScheduler::PostJobAfter(Element&& job, TimerUS delay, uint64 worker)
+{
+	JobRecord* record = m_JobPool.Allocate();
+	_SetJob(record, std::forward<Element>(job));
+	return _PostTimedJob(record, TimerWheel::Now() + (uint64)(TMAX(delay.count(), (TimerUS::rep)0)), 0, worker);
+}
+
+template<class Element>
+FiberJobPtr FiberScheduler::PostJobAt(Element&& job, std::chrono::steady_clock::time_point deadline, uint64 worker)
+{
+	JobRecord* record = m_JobPool.Allocate();
+	_SetJob(record, std::forward<Element>(job));
+	return _PostTimedJob(record, (uint64)std::chrono::duration_cast<TimerUS>(deadline.time_since_epoch()).count(), 0, worker);
+}
+
+template<class Element>
+FiberJobPtr FiberScheduler::PostJobEvery(Element&& job, TimerUS period, uint64 worker)
+{
+	ASSERT(period.count() > 0);
+	JobRecord* record = m_JobPool.Allocate();
+	_SetJob(record, std::forward<Element>(job));
+	return _PostTimedJob(record, TimerWheel::Now() + (uint64)period.count(), (uint64)period.count(), worker);
+}
+
+template<class Element>
+FiberJobPtr FiberScheduler::PostJobBefore(Element&& job, std::chrono::steady_clock::time_point deadline, uint64 worker)
+{
+	JobRecord* record = m_JobPool.Allocate();
+	_SetJob(record, std::forward<Element>(job));
+	record->m_Job.m_DeadlineUS = TMAX((uint64)std::chrono::duration_cast<TimerUS>(deadline.time_since_epoch()).count(), (uint64)1);
+	return _PostJob(record, nullptr, worker, true);
+}
+
+template<class Iterator>
+std::vector<FiberJobPtr> FiberScheduler::PostJobs(Iterator first, Iterator last, uint64 worker)
+{
+	std::vector<FiberJobPtr> handles;
+	std::vector<FiberJob*> jobs;
+	for (; first != last; ++first)
+	{
+		JobRecord* record = m_JobPool.Allocate();
+		_SetJob(record, *first);
+		record->m_Holds.store(1, std::memory_order_relaxed);
+		_InitJob(record, worker);
+		handles.push_back(FiberJobPtr::Adopt(record));
+		jobs.push_back(&record->m_Job);
+	}
+	PushJobs(jobs.data(), jobs.size());
+	return handles;
+}
+
+template<class Iterator>
+JobSignalPtr FiberScheduler::PostBatch(Iterator first, Iterator last, uint64 worker)
+{
+	JobSignalPtr signal = FetchSignal();
+	std::vector<FiberJob*> jobs;
+	for (; first != last; ++first)
+	{
+		JobRecord* record = m_JobPool.Allocate();
+		_SetJob(record, *first);
+		_InitJob(record, worker);
+		jobs.push_back(&record->m_Job);
+	}
+	if (jobs.empty())
+		return signal;
+
+	// Arm once for the whole batch, each job then only links its signal to it
+	signal->Arm((int32)jobs.size());
+	for (FiberJob* job : jobs)
+		job->GetJobSignal()->AddTrigger(signal.get(), false);
+	PushJobs(jobs.data(), jobs.size());
+	return signal;
+}
+
+template<class JobType, class Functor>
+FiberJobPtr FiberScheduler::_PostFuncJob(Functor&& func, JobSignal* signal, uint64 worker)
+{
+	JobRecord* record = m_JobPool.Allocate();
+	record->m_Job.EmplaceJob<JobType>(std::forward<Functor>(func));
+	return _PostJob(record, signal, worker, true);
+}
+
+template<class Element>
+void FiberScheduler::_SetJob(JobRecord* record, Element&& element)
+{
+	if constexpr (std::is_convertible<Element, std::shared_ptr<Job>>::value)
+		record->m_Job.SetJob(std::forward<Element>(element));
+	else
+		record->m_Job.EmplaceJob<FuncJob>(std::forward<Element>(element));
+}
+
+template<class Body>
+void FiberScheduler::ParallelFor(SIZET begin, SIZET end, SIZET grain, Body&& body, uint64 worker)
+{
+	if (begin >= end)
+		return;
+
+	// Pieces only run while the caller waits, so they share its body and the context on its stack
+	JobSignalPtr signal = FetchSignal();
+	ParallelForContext<typename std::remove_reference<Body>::type> context{ &body, signal.get(), TMAX(grain, (SIZET)1), worker };
+	if (IsWorkerOf(worker))
+	{
+		_ParallelFor(&context, begin, end);
+	}
+	else
+	{
+		signal->Arm();
+		auto contextPtr = &context;
+		_PostFuncJob<FuncJob>([this, contextPtr, begin, end]() {
+			_ParallelFor(contextPtr, begin, end);
+			contextPtr->m_Signal->Trigger(0);
+		}, nullptr, worker);
+	}
+	YieldFor(signal);
+}
+
+template<class Body>
+void FiberScheduler::_ParallelFor(ParallelForContext<Body>* context, SIZET begin, SIZET end)
+{
+	while (begin < end)
+	{
+		if (end - begin > context->m_Grain && IsStarving(context->m_Worker))
+		{
+			SIZET middle = begin + (end - begin) / 2;
+			context->m_Signal->Arm();
+			_PostFuncJob<FuncJob>([this, context, middle, end]() {
+				_ParallelFor(context, middle, end);
+				context->m_Signal->Trigger(0);
+			}, nullptr, context->m_Worker);
+			end = middle;
+			continue;
+		}
+
+		SIZET chunkEnd = begin + (TMIN(context->m_Grain, end - begin));
+		if constexpr (std::is_invocable<Body&, SIZET, SIZET>::value)
+		{
+			(*context->m_Body)(begin, chunkEnd);
+		}
+		else
+		{
+			for (SIZET index = begin; index < chunkEnd; ++index)
+				(*context->m_Body)(index);
+		}
+		begin = chunkEnd;
+	}
+}
+
+template<class T, class Body, class Join>
+T FiberScheduler::ParallelReduce(SIZET begin, SIZET end, SIZET grain, T identity, Body&& body, Join&& join, uint64 worker)
+{
+	if (begin >= end)
+		return identity;
+
+	ParallelReduceContext<T, typename std::remove_reference<Body>::type, typename std::remove_reference<Join>::type> context{ &body, &join, identity, TMAX(grain, (SIZET)1), worker };
+	if (IsWorkerOf(worker))
+		return _ParallelReduce(&context, begin, end);
+
+	T result = identity;
+	auto contextPtr = &context;
+	auto resultPtr = &result;
+	FiberJobPtr job = _PostFuncJob<FuncJob>([this, contextPtr, resultPtr, begin, end]() {
+		*resultPtr = _ParallelReduce(contextPtr, begin, end);
+	}, nullptr, worker);
+	YieldFor(job->GetSignal());
+	return result;
+}
+
+template<class T, class Body, class Join>
+T FiberScheduler::_ParallelReduce(ParallelReduceContext<T, Body, Join>* context, SIZET begin, SIZET end)
+{
+	struct Piece
+	{
+		T           m_Result;
+		FiberJobPtr m_Job;
+	};
+
+	// Split off pieces are the right halves of what is left, so they are joined back in reverse
+	std::deque<Piece> pieces;
+	T result = context->m_Identity;
+	while (begin < end)
+	{
+		if (end - begin > context->m_Grain && IsStarving(context->m_Worker))
+		{
+			SIZET middle = begin + (end - begin) / 2;
+			pieces.push_back(Piece{ context->m_Identity, nullptr });
+			Piece* piece = &pieces.back();
+			piece->m_Job = _PostFuncJob<FuncJob>([this, context, piece, middle, end]() {
+				piece->m_Result = _ParallelReduce(context, middle, end);
+			}, nullptr, context->m_Worker);
+			end = middle;
+			continue;
+		}
+
+		SIZET chunkEnd = begin + (TMIN(context->m_Grain, end - begin));
+		result = (*context->m_Body)(begin, chunkEnd, std::move(result));
+		begin = chunkEnd;
+	}
+
+	for (auto it = pieces.rbegin(); it != pieces.rend(); ++it)
+	{
+		YieldFor(it->m_Job->GetSignal());
+		result = (*context->m_Join)(std::move(result), std::move(it->m_Result));
+	}
+	return result;
+}
+
+template<class T, class Body, class Join>
+T FiberScheduler::ParallelScan(SIZET begin, SIZET end, SIZET grain, T identity, Body&& body, Join&& join, uint64 worker)
+{
+	if (begin >= end)
+		return identity;
+
+	// Two passes over the same blocks: block sums, then a serial scan of the sums and the final pass
+	grain = TMAX(grain, (SIZET)1);
+	SIZET count = end - begin;
+	SIZET maxBlocks = (TMAX(m_Workers.size(), (SIZET)1)) * 4;
+	SIZET blockCount = TMIN((count + grain - 1) / grain, maxBlocks);
+	SIZET blockSize = (count + blockCount - 1) / blockCount;
+	blockCount = (count + blockSize - 1) / blockSize;
+
+	std::vector<T> prefixes(blockCount, identity);
+	if (blockCount > 1)
+	{
+		ParallelFor(0, blockCount, 1, [&](SIZET block) {
+			SIZET blockBegin = begin + block * blockSize;
+			prefixes[block] = body(blockBegin, TMIN(blockBegin + blockSize, end), identity, false);
+		}, worker);
+	}
+
+	T total = identity;
+	for (T& prefix : prefixes)
+	{
+		T sum = std::move(prefix);
+		prefix = total;
+		total = join(std::move(total), std::move(sum));
+	}
+
+	T last = identity;
+	ParallelFor(0, blockCount, 1, [&](SIZET block) {
+		SIZET blockBegin = begin + block * blockSize;
+		T sum = body(blockBegin, TMIN(blockBegin + blockSize, end), prefixes[block], true);
+		if (block == blockCount - 1)
+			last = std::move(sum);
+	}, worker);
+	return blockCount > 1 ? total : last;
+}
+
+
+template<class Functor>
+FiberJobPtr FiberJob::PostSuccessor(Functor&& func, uint64 worker)
+{
+	return m_Scheduler->_PostFuncJob<FuncJob>(std::forward<Functor>(func), GetJobSignal(), worker);
 }
 
 template<class Functor>
-FiberJobPtr FiberScheduler::PostJob(Functor&& func, JobSignalPtr signal, uint64 worker)
+FiberJobPtr FiberJob::PostCompletor(Functor&& func)
 {
-	std::shared_ptr<Job> job = std::allocate_shared<FuncJob>(m_JobAllocator, std::forward<Functor>(func));
-	return PostJob(job, signal, worker);
+	return m_Scheduler->_PostFuncJob<FuncCompletorJob>(std::forward<Functor>(func), GetJobSignal(), ThreadWorker::GetCurrentThreadFilter());
 }
 
 //------------------------------------------------------------------------------
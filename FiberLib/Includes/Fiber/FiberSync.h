@@ -0,0 +1,159 @@
+// FiberSync.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include <atomic>
+
+class FiberDesc;
+
+
+// struct FiberWaiter
+//------------------------------------------------------------------------------
+// Wait queue entry on the stack of the waiting fiber. A waiter that isn't on a
+// fiber, a plain thread or a worker outside of a job, sleeps on m_Woken instead.
+struct FiberWaiter
+{
+	FiberWaiter*        m_Next{ nullptr };
+	FiberDesc*          m_Fiber{ nullptr };
+	uint32              m_WorkerID{ 0 };
+	std::atomic<uint32> m_Woken{ 0 };
+
+	FiberWaiter();
+
+	// Only after the waiter is out of every queue lock, it may be resumed before it is suspended
+	void Suspend();
+	// The waiter may be gone as soon as this returns
+	void Resume();
+};
+
+
+// class FiberWaitQueue
+//------------------------------------------------------------------------------
+// FIFO of waiters behind a spinlock, only ever held for a few pointer updates.
+class FiberWaitQueue
+{
+public:
+	static constexpr uint32 SPIN_COUNT = 64;		// tries before a contended primitive parks its fiber
+
+	void         Lock();
+	FORCE_INLINE void Unlock() { m_Lock.store(false, std::memory_order_release); }
+
+	void         Push(FiberWaiter* waiter);
+	FiberWaiter* Pop();
+	FiberWaiter* PopAll();
+	FORCE_INLINE bool IsEmpty() const { return m_Head == nullptr; }
+
+	// Resumes a list taken with PopAll
+	static void  ResumeAll(FiberWaiter* waiter);
+
+private:
+	std::atomic<bool> m_Lock{ false };
+	FiberWaiter*      m_Head{ nullptr };
+	FiberWaiter*      m_Tail{ nullptr };
+};
+
+
+// class FiberMutex
+//------------------------------------------------------------------------------
+// Spins a little when contended, then parks the fiber and lets its worker run
+// other jobs. Unlock hands the mutex straight to the first waiter. The lower
+// case names make it work with std::lock_guard and std::unique_lock.
+class FiberMutex
+{
+public:
+	FiberMutex() = default;
+	FiberMutex(const FiberMutex&) = delete;
+
+	void Lock();
+	bool TryLock();
+	void Unlock();
+
+	FORCE_INLINE void lock() { Lock(); }
+	FORCE_INLINE bool try_lock() { return TryLock(); }
+	FORCE_INLINE void unlock() { Unlock(); }
+
+private:
+	enum State : uint32
+	{
+		UNLOCKED = 0,
+		LOCKED,
+		CONTENDED		// locked, and there may be waiters
+	};
+
+	std::atomic<uint32> m_State{ UNLOCKED };
+	FiberWaitQueue      m_Waiters;
+};
+
+
+// class FiberConditionVariable
+//------------------------------------------------------------------------------
+class FiberConditionVariable
+{
+public:
+	FiberConditionVariable() = default;
+	FiberConditionVariable(const FiberConditionVariable&) = delete;
+
+	// The mutex is released while parked and held again on return
+	void Wait(FiberMutex& mutex);
+	template<class Predicate>
+	void Wait(FiberMutex& mutex, Predicate&& predicate)
+	{
+		while (!predicate())
+			Wait(mutex);
+	}
+
+	void NotifyOne();
+	void NotifyAll();
+
+private:
+	FiberWaitQueue m_Waiters;
+};
+
+
+// class FiberSemaphore
+//------------------------------------------------------------------------------
+// Release hands a permit straight to the first waiter, and skips the queue
+// entirely while nobody waits.
+class FiberSemaphore
+{
+public:
+	explicit FiberSemaphore(int32 count = 0) : m_Count(count) {}
+	FiberSemaphore(const FiberSemaphore&) = delete;
+
+	void Acquire();
+	bool TryAcquire();
+	void Release(int32 count = 1);
+
+	FORCE_INLINE int32 GetCount() const { return m_Count.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<int32>  m_Count;
+	std::atomic<uint32> m_WaiterCount{ 0 };
+	FiberWaitQueue      m_Waiters;
+};
+
+
+// class FiberBarrier
+//------------------------------------------------------------------------------
+// Reusable barrier for a fixed number of participants, ArriveAndWait returns
+// true for the one that completed the phase.
+class FiberBarrier
+{
+public:
+	explicit FiberBarrier(uint32 count) : m_Count(count) {}
+	FiberBarrier(const FiberBarrier&) = delete;
+
+	bool ArriveAndWait();
+
+private:
+	const uint32        m_Count;
+	uint32              m_Arrived{ 0 };
+	std::atomic<uint32> m_Phase{ 0 };
+	FiberWaitQueue      m_Waiters;
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
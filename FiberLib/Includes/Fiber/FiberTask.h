@@ -0,0 +1,259 @@
+// FiberTask.h
+//------------------------------------------------------------------------------
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+	#error "FiberTask.h needs C++20 coroutines, build with USE_CXX20"
+#endif
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include "Fiber/FiberJob.h"
+#include "Fiber/FiberScheduler.h"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+
+template<class T>
+class Task;
+
+
+// struct SignalAwaiter
+//------------------------------------------------------------------------------
+// co_await on a signal or a job, the task is resumed by a successor job on its
+// worker group and gets the signal result.
+struct SignalAwaiter
+{
+	JobSignalPtr    m_Signal;
+	FiberScheduler* m_Scheduler;
+	uint64          m_Worker;
+
+	bool  await_ready() const;
+	void  await_suspend(std::coroutine_handle<> handle);
+	int32 await_resume() const;
+};
+
+
+// struct ScheduleAwaiter
+//------------------------------------------------------------------------------
+// co_await scheduler.Schedule(filter) moves the task to a worker of the filter,
+// which stays its worker group for the signals it waits on afterwards.
+struct ScheduleAwaiter
+{
+	FiberScheduler* m_Scheduler;
+	uint64          m_Worker;
+
+	bool await_ready() const { return false; }
+	template<class Promise>
+	void await_suspend(std::coroutine_handle<Promise> handle);
+	void await_resume() const {}
+};
+
+
+// class TaskPromiseBase
+//------------------------------------------------------------------------------
+// A task starts suspended and runs when started on a scheduler or awaited by
+// another task. Once done it resumes its awaiter right away, or fires the
+// signal Start returned. Frames come from the scheduler's pool when the task is
+// created on one of its workers, so the scheduler must outlive its tasks.
+class TaskPromiseBase
+{
+public:
+	struct FinalAwaiter
+	{
+		bool await_ready() const noexcept { return false; }
+		template<class Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept { return handle.promise().Finish(); }
+		void await_resume() const noexcept {}
+	};
+
+	TaskPromiseBase();
+
+	std::suspend_always initial_suspend() const noexcept { return {}; }
+	FinalAwaiter        final_suspend() const noexcept { return {}; }
+	void                unhandled_exception() { m_Exception = std::current_exception(); }
+
+	// Taken by value so they win over the pass through for any kind of handle
+	SignalAwaiter       await_transform(JobSignalPtr signal) { return SignalAwaiter{ std::move(signal), m_Scheduler, m_Worker }; }
+	SignalAwaiter       await_transform(FiberJobPtr job) { return SignalAwaiter{ job->GetSignal(), m_Scheduler, m_Worker }; }
+	template<class Awaitable>
+	Awaitable&&         await_transform(Awaitable&& awaitable) { return std::forward<Awaitable>(awaitable); }
+
+	static void* operator new(SIZET size);
+	static void  operator delete(void* ptr, SIZET size);
+
+	static void  PostResume(FiberScheduler* scheduler, std::coroutine_handle<> handle, uint64 worker);
+
+	FiberScheduler*         m_Scheduler;
+	uint64                  m_Worker;
+	std::coroutine_handle<> m_Continuation;
+
+protected:
+	JobSignalPtr            Start(std::coroutine_handle<> handle, FiberScheduler& scheduler, uint64 worker);
+	std::coroutine_handle<> Finish() noexcept;
+	void                    Rethrow() const;
+
+	JobSignal*              m_DoneSignal;
+	std::exception_ptr      m_Exception;
+
+	template<class T>
+	friend class Task;
+};
+
+
+// class TaskPromise
+//------------------------------------------------------------------------------
+template<class T>
+class TaskPromise : public TaskPromiseBase
+{
+public:
+	Task<T> get_return_object();
+
+	template<class U>
+	void return_value(U&& value) { m_Value.emplace(std::forward<U>(value)); }
+
+	T& GetResult()
+	{
+		Rethrow();
+		return *m_Value;
+	}
+
+private:
+	std::optional<T> m_Value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase
+{
+public:
+	Task<void> get_return_object();
+
+	void return_void() {}
+	void GetResult() { Rethrow(); }
+};
+
+
+// class Task
+//------------------------------------------------------------------------------
+// Stackless job: a suspended task keeps only its coroutine frame, while a
+// suspended fiber pins a whole stack. Tasks run on the FiberWorkers next to the
+// fiber jobs, each resumption as a job of its worker group.
+template<class T = void>
+class Task
+{
+public:
+	using promise_type = TaskPromise<T>;
+	using Handle = std::coroutine_handle<promise_type>;
+	using Result = typename std::add_lvalue_reference<T>::type;
+
+	Task() = default;
+	explicit Task(Handle handle) : m_Handle(handle) {}
+	Task(Task&& other) noexcept : m_Handle(std::exchange(other.m_Handle, nullptr)) {}
+	~Task() { Reset(); }
+
+	Task(const Task&) = delete;
+
+	Task& operator=(Task&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			m_Handle = std::exchange(other.m_Handle, nullptr);
+		}
+		return *this;
+	}
+
+	FORCE_INLINE bool IsDone() const { return !m_Handle || m_Handle.done(); }
+
+	// Runs the task on a worker of the filter, the signal fires once it is done
+	JobSignalPtr Start(FiberScheduler& scheduler, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN)
+	{
+		ASSERT(m_Handle && !m_Handle.done());
+		return m_Handle.promise().Start(m_Handle, scheduler, worker);
+	}
+
+	// Result of a finished task, rethrows what escaped its body
+	Result GetResult()
+	{
+		ASSERT(m_Handle && m_Handle.done());
+		return m_Handle.promise().GetResult();
+	}
+
+	// Awaiting a task runs it right away on the awaiting worker, in the awaiter's worker group
+	template<bool Move>
+	struct Awaiter
+	{
+		Handle m_Handle;
+
+		bool await_ready() const noexcept { return !m_Handle || m_Handle.done(); }
+
+		template<class Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> caller) noexcept
+		{
+			promise_type& promise = m_Handle.promise();
+			if constexpr (std::is_base_of<TaskPromiseBase, Promise>::value)
+			{
+				promise.m_Scheduler = caller.promise().m_Scheduler;
+				promise.m_Worker = caller.promise().m_Worker;
+			}
+			promise.m_Continuation = caller;
+			return m_Handle;
+		}
+
+		decltype(auto) await_resume()
+		{
+			if constexpr (Move && !std::is_void<T>::value)
+				return std::move(m_Handle.promise().GetResult());
+			else
+				return m_Handle.promise().GetResult();
+		}
+	};
+
+	Awaiter<false> operator co_await() & noexcept { return Awaiter<false>{ m_Handle }; }
+	Awaiter<true>  operator co_await() && noexcept { return Awaiter<true>{ m_Handle }; }
+
+private:
+	void Reset()
+	{
+		if (m_Handle)
+			m_Handle.destroy();
+		m_Handle = nullptr;
+	}
+
+	Handle m_Handle;
+};
+
+
+template<class T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+	return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+	return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+template<class Promise>
+void ScheduleAwaiter::await_suspend(std::coroutine_handle<Promise> handle)
+{
+	if constexpr (std::is_base_of<TaskPromiseBase, Promise>::value)
+	{
+		handle.promise().m_Scheduler = m_Scheduler;
+		handle.promise().m_Worker = m_Worker;
+	}
+	TaskPromiseBase::PostResume(m_Scheduler, handle, m_Worker);
+}
+
+inline ScheduleAwaiter FiberScheduler::Schedule(uint64 worker)
+{
+	return ScheduleAwaiter{ this, worker };
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
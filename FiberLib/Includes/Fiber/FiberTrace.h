@@ -0,0 +1,87 @@
+// FiberTrace.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include <atomic>
+
+
+// namespace FiberTrace
+//------------------------------------------------------------------------------
+// Scheduler event recorder. Every thread writes timestamped events to its own
+// ring, made on its first event, no other thread ever writes there, so an
+// event costs a clock read and a 32 byte store. A full ring overwrites its
+// oldest events. Recording starts with Enable, and
+// WriteChromeJson turns the rings into a trace for chrome://tracing or the
+// Perfetto UI: a slice per job run, split where its fiber was suspended,
+// arrows from post to start, park slices and instants for steals, signals
+// and fiber switches.
+//
+// The scheduler only records when built with ENABLE_TRACING (__TRACING__),
+// otherwise FIBER_TRACE expands to nothing and the hot path is untouched.
+namespace FiberTrace
+{
+	static constexpr uint32 RING_SIZE = 64 * KILOBYTE;		// events per ring
+
+	enum class EventType : uint8
+	{
+		JOB_POST = 0,
+		JOB_START,
+		JOB_END,
+		JOB_STEAL,			// arg is the victim worker
+		FIBER_SUSPEND,		// the running job gives its worker up
+		FIBER_RESUME,
+		FIBER_SWITCH,		// a worker picks a ready fiber up
+		WORKER_PARK,
+		WORKER_UNPARK,
+		SIGNAL_TRIGGER,
+		USER
+	};
+
+	struct Event
+	{
+		uint64      m_TimeNS;
+		uint64      m_ID;
+		const char* m_Name;
+		uint32      m_Arg;
+		EventType   m_Type;
+	};
+
+	void  Enable(bool enable);
+	void  Clear();
+	void  Record(EventType type, uint64 id, const char* name = nullptr, uint32 arg = 0);
+	// Events kept in all rings, at most RING_SIZE per ring
+	SIZET GetEventCount();
+	// Best effort while workers record, events overwritten during the copy are dropped
+	bool  WriteChromeJson(const char* path);
+
+	extern std::atomic<bool> s_Enabled;
+	FORCE_INLINE bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+	// Jobs posted by this thread while the scope lives are named after it, the name must outlive the trace
+	class JobNameScope
+	{
+	public:
+		explicit JobNameScope(const char* name);
+		~JobNameScope();
+
+		JobNameScope(const JobNameScope&) = delete;
+
+		static const char* GetCurrent();
+
+	private:
+		const char* m_Previous;
+	};
+}
+
+#if defined(__TRACING__)
+	#define FIBER_TRACE(type, id, name, arg) \
+		do { if (FiberTrace::IsEnabled()) FiberTrace::Record(FiberTrace::EventType::type, (id), (name), (arg)); } while (0)
+#else
+	#define FIBER_TRACE(type, id, name, arg) ((void)0)
+#endif
+
+//------------------------------------------------------------------------------
\ No newline at end of file
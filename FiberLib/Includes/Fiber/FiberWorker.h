@@ -7,32 +7,105 @@
 #include "Types.h"
 #include "Misc.h"
 #include "Worker.h"
+#include "Job.h"
+#include "WorkStealingQueue.h"
+#include "Fiber/TimerWheel.h"
+#include "Fiber/FiberIO.h"
+#include "Fiber/SchedulerStats.h"
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <vector>
 
 class FiberDesc;
+class FiberJob;
 class FiberScheduler;
 
 
+// Idle policy
+//------------------------------------------------------------------------------
+// A worker out of work spins for m_SpinUS, then yields its thread until
+// m_YieldUS more have passed, then parks until a job wakes it.
+struct IdlePolicy
+{
+	enum class Preset : uint8
+	{
+		LOW_LATENCY,
+		BALANCED,
+		POWER_SAVING
+	};
+
+	static IdlePolicy FromPreset(Preset preset);
+
+	uint32 m_SpinUS{ 20 };
+	uint32 m_YieldUS{ 50 };
+};
+
+struct IdleStats
+{
+	uint64 m_SpinNS{ 0 };
+	uint64 m_YieldNS{ 0 };
+	uint64 m_ParkNS{ 0 };
+	uint64 m_ParkCount{ 0 };
+};
+
+
 // WorkerThread
 //------------------------------------------------------------------------------
 class FiberWorker: public ThreadWorker
 {
 public:
+	enum IdlePhase : uint8
+	{
+		IDLE_SPIN = 0,
+		IDLE_YIELD,
+		IDLE_PARK,
+		IDLE_PHASE_MAX
+	};
+
 	explicit FiberWorker(const char* name, uint32 threadID);
 	virtual ~FiberWorker();
 
 	FORCE_INLINE void SetScheduler(FiberScheduler* scheduler) { m_Scheduler = scheduler; }
 
+	void      Idle(const IdlePolicy& policy, uint64 remainUS);
+	IdleStats GetIdleStats() const;
+	FORCE_INLINE void ResetIdle() { m_IdleStart = std::chrono::steady_clock::time_point(); }
+
+	// The ring and the reactor are set up on first use, only by the worker's own thread
+	IoRing*   GetIoRing(bool create = true);
+	Reactor*  GetReactor(bool create = true);
+
 	static FiberWorker* GetCurrentThreadWorker();
 
 protected:
 	virtual void Main();
+	// With I/O in flight the worker parks in its reactor, so a completion or a ready socket wakes it as well
+	virtual void WaitForWakeUp(uint64 timeUS);
+	virtual void SignalWakeUp();
 
 public:
-	void*           m_MainFiber{ nullptr };
-	FiberDesc*      m_CurrentFiber{ nullptr };
-	FiberScheduler* m_Scheduler{ nullptr };
+	using JobQueue = WorkStealingQueue<FiberJob>;
+
+	void*               m_MainFiber{ nullptr };
+	FiberDesc*          m_CurrentFiber{ nullptr };
+	FiberDesc*          m_DeferredFiber{ nullptr };
+	FiberJob*           m_HandoffJob{ nullptr };		// job waiting for a fiber with a larger stack
+	FiberScheduler*     m_Scheduler{ nullptr };
+	JobQueue            m_Jobs[(int)Job::Priority::PRIO_MAX];
+	std::atomic<uint32> m_ReadyFiberCount{ 0 };
+	TimerWheel          m_Timers;		// delayed jobs and polling fibers this worker wakes up
+
+	std::chrono::steady_clock::time_point m_IdleStart;		// zero while the worker has work
+	std::atomic<uint64> m_IdleNS[IDLE_PHASE_MAX]{};
+	std::atomic<uint64> m_ParkCount{ 0 };
+	WorkerMetrics       m_Metrics;
+	std::vector<FiberWorker*> m_Victims;		// the others in the order it steals from them, nearest first
+
+private:
+	std::atomic<IoRing*>  m_IoRing{ nullptr };
+	std::atomic<Reactor*> m_Reactor{ nullptr };
+	std::atomic<bool>     m_IoWaiting{ false };		// parked in the reactor, wakeups go through its eventfd
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,217 @@
+// JobEpoch.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include "InlineFunction.h"
+#include "Fiber/FiberJob.h"
+#include "Fiber/FiberScheduler.h"
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+// class EpochArena
+//------------------------------------------------------------------------------
+// Bump allocator of one thread in an epoch. Nothing is freed on its own, a
+// reset rewinds to the first chunk and keeps all of them, so a graph of the
+// same shape every tick stops allocating after the first ones.
+class EpochArena
+{
+public:
+	static constexpr SIZET CHUNK_SIZE = 64 * KILOBYTE;
+
+	EpochArena() = default;
+	~EpochArena();
+
+	EpochArena(const EpochArena&) = delete;
+
+	void* Allocate(SIZET size, SIZET alignment);
+	void  Reset();
+
+	FORCE_INLINE SIZET GetReserved() const { return m_Reserved; }
+
+private:
+	struct alignas(std::max_align_t) Chunk
+	{
+		Chunk* m_Next;
+		SIZET  m_Size;
+	};
+
+	uint8* m_Cursor{ nullptr };
+	uint8* m_End{ nullptr };
+	Chunk* m_Current{ nullptr };
+	Chunk* m_Chunks{ nullptr };
+	SIZET  m_Reserved{ 0 };
+};
+
+
+// class JobEpoch
+//------------------------------------------------------------------------------
+// Scope of a transient job graph, taken with FiberScheduler::BeginEpoch. Jobs
+// posted through the epoch keep captures too big for the job record in the
+// arena of the posting worker instead of the heap, and New places state the
+// graph shares there too. Once the epoch is ended and all of its jobs have
+// run, every arena is rewound at once and the signal End returned fires.
+// Jobs of the epoch may post more jobs to it until then. A job dropped or
+// expired before it ran counts as run once its last handle is let go.
+class JobEpoch
+{
+public:
+	explicit JobEpoch(FiberScheduler* scheduler);
+
+	JobEpoch(const JobEpoch&) = delete;
+
+	template<class Functor>
+	FiberJobPtr PostJob(Functor&& func, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+	template<class Functor>
+	FiberJobPtr PostJob(Functor&& func, const JobSignalPtr& signal, uint64 worker = ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN);
+
+	// Lives until the epoch is reset, which runs no destructors
+	template<class T, class... Args>
+	T*    New(Args&&... args);
+	void* Allocate(SIZET size, SIZET alignment = alignof(std::max_align_t));
+
+	// Memory kept by the arenas, only stable while no job of the epoch runs
+	SIZET GetReserved() const;
+
+private:
+	// Small captures stay in the job record next to the epoch, larger ones are referenced in the arena.
+	// Whichever of the call and its destructor comes first counts the job down, a moved from one never does.
+	template<class Functor>
+	struct InlineCall
+	{
+		template<class Func>
+		InlineCall(JobEpoch* epoch, Func&& func) : m_Epoch(epoch), m_Func(std::forward<Func>(func)) {}
+		InlineCall(InlineCall&& other) noexcept(std::is_nothrow_move_constructible<Functor>::value)
+			: m_Epoch(std::exchange(other.m_Epoch, nullptr)), m_Func(std::move(other.m_Func)) {}
+		~InlineCall()
+		{
+			if (m_Epoch)
+				m_Epoch->Release();
+		}
+
+		int32 operator()()
+		{
+			int32 result = Invoke(m_Func);
+			std::exchange(m_Epoch, nullptr)->Release();
+			return result;
+		}
+
+		JobEpoch* m_Epoch;
+		Functor   m_Func;
+	};
+
+	template<class Functor>
+	struct ArenaCall
+	{
+		ArenaCall(JobEpoch* epoch, Functor* func) : m_Epoch(epoch), m_Func(func) {}
+		ArenaCall(ArenaCall&& other) noexcept : m_Epoch(std::exchange(other.m_Epoch, nullptr)), m_Func(other.m_Func) {}
+		~ArenaCall()
+		{
+			if (m_Epoch)
+				Finish();
+		}
+
+		int32 operator()()
+		{
+			int32 result = Invoke(*m_Func);
+			Finish();
+			return result;
+		}
+
+		void Finish()
+		{
+			// Only the destructor runs, the memory goes with the arena
+			m_Func->~Functor();
+			std::exchange(m_Epoch, nullptr)->Release();
+		}
+
+		JobEpoch* m_Epoch;
+		Functor*  m_Func;
+	};
+
+	template<class Functor>
+	static int32 Invoke(Functor& func);
+
+	void         Begin();
+	JobSignalPtr End();
+	void         Release();
+
+	FiberScheduler*    m_Scheduler;
+	std::atomic<int32> m_Pending;		// jobs not run yet, and one for the open scope
+	JobSignalPtr       m_Done;
+	EpochArena         m_Arenas[THREAD_COUNT_MAX];
+	EpochArena         m_SharedArena;		// threads that aren't workers of the scheduler
+	std::mutex         m_SharedLock;
+
+	friend class EpochScope;
+	friend class FiberScheduler;
+};
+
+
+// class EpochScope
+//------------------------------------------------------------------------------
+// Open epoch of the caller. End closes it and returns the signal that fires
+// once its jobs have run, a scope left without End closes it too.
+class EpochScope
+{
+public:
+	explicit EpochScope(JobEpoch* epoch) : m_Epoch(epoch) {}
+	EpochScope(EpochScope&& other) noexcept : m_Epoch(std::exchange(other.m_Epoch, nullptr)) {}
+	~EpochScope() { End(); }
+
+	EpochScope(const EpochScope&) = delete;
+
+	JobSignalPtr End();
+
+	FORCE_INLINE JobEpoch* operator->() const { return m_Epoch; }
+	FORCE_INLINE JobEpoch& operator*() const { return *m_Epoch; }
+
+private:
+	JobEpoch* m_Epoch;
+};
+
+
+template<class Functor>
+FiberJobPtr JobEpoch::PostJob(Functor&& func, uint64 worker)
+{
+	return PostJob(std::forward<Functor>(func), JobSignalPtr(), worker);
+}
+
+template<class Functor>
+FiberJobPtr JobEpoch::PostJob(Functor&& func, const JobSignalPtr& signal, uint64 worker)
+{
+	using Type = typename std::decay<Functor>::type;
+	ASSERT(m_Pending.load(std::memory_order_relaxed) > 0);
+	m_Pending.fetch_add(1, std::memory_order_relaxed);
+	if constexpr (InlineFunction<int32()>::IsInline<InlineCall<Type>>())
+		return m_Scheduler->PostJob(InlineCall<Type>(this, std::forward<Functor>(func)), signal, worker);
+	else
+		return m_Scheduler->PostJob(ArenaCall<Type>(this, New<Type>(std::forward<Functor>(func))), signal, worker);
+}
+
+template<class T, class... Args>
+T* JobEpoch::New(Args&&... args)
+{
+	return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+template<class Functor>
+/*static*/ int32 JobEpoch::Invoke(Functor& func)
+{
+	if constexpr (std::is_void<decltype(func())>::value)
+	{
+		func();
+		return 0;
+	}
+	else
+		return (int32)func();
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,49 @@
+// JobPool.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include "Fiber/FiberJob.h"
+#include <atomic>
+#include <mutex>
+
+
+// class JobPool
+//------------------------------------------------------------------------------
+// Slab of JobRecords addressed by a 32 bit index, recycled through a lock free
+// free list. Records are allocated chunk by chunk and never released before the
+// pool, so a stale index always resolves to valid memory and only the record
+// generation tells it was recycled.
+class JobPool
+{
+public:
+	static constexpr uint32 CHUNK_SIZE = 1024;
+	static constexpr uint32 MAX_CHUNKS = 4096;
+
+	JobPool();
+	~JobPool();
+
+	JobPool(const JobPool&) = delete;
+
+	JobRecord* Allocate();
+	void       Free(JobRecord* record);
+
+	FORCE_INLINE JobRecord* Resolve(uint32 index) const
+	{
+		return m_Chunks[index / CHUNK_SIZE].load(std::memory_order_acquire) + index % CHUNK_SIZE;
+	}
+	FORCE_INLINE uint32     GetRecordCount() const { return m_Count.load(std::memory_order_relaxed); }
+
+private:
+	JobRecord* AllocateChunk(uint32 chunk);
+
+	std::atomic<uint64>     m_FreeHead;		// tag << 32 | (index + 1), 0 when empty
+	std::atomic<uint32>     m_Count;		// records ever taken from the chunks
+	std::atomic<JobRecord*> m_Chunks[MAX_CHUNKS];
+	std::mutex              m_ChunkLock;
+};
+
+//------------------------------------------------------------------------------
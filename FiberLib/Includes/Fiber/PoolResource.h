@@ -0,0 +1,86 @@
+// PoolResource.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include "Worker.h"
+#include <atomic>
+#include <memory_resource>
+#include <mutex>
+
+
+// class PoolResource
+//------------------------------------------------------------------------------
+// Memory resource with a cache per worker thread, so workers allocate without
+// sharing a lock or a cache line. Each cache carves blocks of a few size
+// classes out of its own spans and keeps a free list per class. A block freed
+// on another thread goes back to the cache that owns its span through a lock
+// free remote list, which the owner takes over in one exchange once its local
+// list runs dry. Spans are only released with the resource.
+//
+// A thread uses its cache once bound with BindCurrentThread, any other thread
+// goes through a shared cache behind a lock. Larger or over-aligned blocks come
+// from the upstream resource.
+class PoolResource : public std::pmr::memory_resource
+{
+public:
+	static constexpr SIZET  SPAN_SIZE = 64 * KILOBYTE;
+	static constexpr SIZET  MAX_BLOCK_SIZE = 4 * KILOBYTE;
+	static constexpr SIZET  BLOCK_ALIGN = 16;
+	static constexpr uint32 CLASS_COUNT = 28;		// four classes per power of two from 16 bytes to 4KB
+
+	explicit PoolResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+	~PoolResource();
+
+	PoolResource(const PoolResource&) = delete;
+
+	// The calling thread allocates from cache index from now on, one thread per index
+	void   BindCurrentThread(uint32 index);
+
+	FORCE_INLINE uint32 GetSpanCount() const { return m_SpanCount.load(std::memory_order_relaxed); }
+
+protected:
+	void*  do_allocate(SIZET bytes, SIZET alignment) override;
+	void   do_deallocate(void* ptr, SIZET bytes, SIZET alignment) override;
+	bool   do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+	struct Block
+	{
+		Block* m_Next;
+	};
+
+	struct Cache;
+
+	// Header in front of the blocks of every span, found by rounding a block address down
+	struct Span
+	{
+		Cache* m_Owner;
+		Span*  m_Next;
+		uint32 m_Class;
+	};
+
+	struct alignas(64) Cache
+	{
+		Block*              m_Free[CLASS_COUNT]{};
+		uint8*              m_Carve[CLASS_COUNT]{};		// unused tail of the newest span of the class
+		uint8*              m_CarveEnd[CLASS_COUNT]{};
+		Span*               m_Spans{ nullptr };
+		alignas(64) std::atomic<Block*> m_Remote[CLASS_COUNT]{};
+	};
+
+	Cache* GetThreadCache() const;
+	void*  Allocate(Cache* cache, uint32 sizeClass);
+	void*  Carve(Cache* cache, uint32 sizeClass);
+
+	std::pmr::memory_resource* m_Upstream;
+	std::atomic<Cache*>        m_Caches[THREAD_COUNT_MAX];
+	Cache                      m_Shared;
+	std::mutex                 m_SharedLock;
+	std::atomic<uint32>        m_SpanCount;
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,124 @@
+// SchedulerStats.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include "Job.h"
+#include <atomic>
+#include <vector>
+
+
+// struct LatencyHistogram
+//------------------------------------------------------------------------------
+// Log-linear histogram of nanoseconds in the HDR style: values below 16 have a
+// bucket each, above that every power of two is split in 8 buckets, so any
+// value is known within 12.5%. Values past MAX_NS land in the last bucket.
+struct LatencyHistogram
+{
+	static constexpr uint32 SUB_BITS = 3;
+	static constexpr uint32 SUB_COUNT = 1 << SUB_BITS;
+	static constexpr uint32 MAX_BITS = 40;		// about 18 minutes
+	static constexpr uint64 MAX_NS = ((uint64)1 << MAX_BITS) - 1;
+	static constexpr uint32 BUCKET_COUNT = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+	static uint32 GetBucket(uint64 ns);
+	static uint64 GetBucketLow(uint32 bucket);
+
+	void   Add(uint64 ns);
+	void   Merge(const LatencyHistogram& other);
+	// Middle of the bucket holding the given fraction of the values, 0.5 for the median
+	uint64 GetPercentile(double fraction) const;
+	FORCE_INLINE uint64 GetMean() const { return m_Count ? m_SumNS / m_Count : 0; }
+
+	uint64 m_Counts[BUCKET_COUNT]{};
+	uint64 m_Count{ 0 };
+	uint64 m_SumNS{ 0 };
+	uint64 m_MaxNS{ 0 };
+};
+
+
+// struct WorkerStats
+//------------------------------------------------------------------------------
+struct WorkerStats
+{
+	uint64 m_JobsExecuted{ 0 };
+	uint64 m_FibersCreated{ 0 };
+	uint64 m_FibersReused{ 0 };		// taken from the pool of free fibers
+	uint64 m_ContextSwitches{ 0 };
+	uint64 m_Steals{ 0 };
+	uint64 m_IdleNS{ 0 };		// spinning, yielding and parked
+	uint64 m_ParkNS{ 0 };
+	uint64 m_ParkCount{ 0 };
+
+	void Merge(const WorkerStats& other);
+};
+
+
+// struct SchedulerStats
+//------------------------------------------------------------------------------
+// Snapshot taken with FiberScheduler::GetStats. Queue latency goes from a job
+// being posted, or its timer firing, to a worker starting it. Run time goes
+// from its start to its end, suspensions included. The histograms are indexed
+// by Job::Priority and kept on the heap, a snapshot is small enough for any
+// fiber stack.
+struct SchedulerStats
+{
+	std::vector<WorkerStats>      m_Workers;
+	WorkerStats                   m_Total;
+	std::vector<LatencyHistogram> m_QueueLatency;
+	std::vector<LatencyHistogram> m_RunTime;
+};
+
+
+// class WorkerMetrics
+//------------------------------------------------------------------------------
+// Counters of one worker, only ever written by its own thread, so an update is
+// a plain load and store. Readers take relaxed loads while it keeps running. It
+// sits on its own cache lines so workers never share one.
+class alignas(64) WorkerMetrics
+{
+public:
+	WorkerMetrics() = default;
+	WorkerMetrics(const WorkerMetrics&) = delete;
+
+	FORCE_INLINE void AddJobExecuted() { Add(m_JobsExecuted, 1); }
+	FORCE_INLINE void AddFiberCreated() { Add(m_FibersCreated, 1); }
+	FORCE_INLINE void AddFiberReused() { Add(m_FibersReused, 1); }
+	FORCE_INLINE void AddContextSwitch() { Add(m_ContextSwitches, 1); }
+	FORCE_INLINE void AddSteal() { Add(m_Steals, 1); }
+	void AddQueueLatency(uint8 prio, uint64 ns);
+	void AddRunTime(uint8 prio, uint64 ns);
+
+	// Adds the counts to the snapshot, the idle times are kept by the worker
+	void CopyTo(WorkerStats& stats, SchedulerStats& histograms) const;
+
+private:
+	struct Histogram
+	{
+		std::atomic<uint64> m_Counts[LatencyHistogram::BUCKET_COUNT]{};
+		std::atomic<uint64> m_Count{ 0 };
+		std::atomic<uint64> m_SumNS{ 0 };
+		std::atomic<uint64> m_MaxNS{ 0 };
+
+		void Add(uint64 ns);
+		void CopyTo(LatencyHistogram& histogram) const;
+	};
+
+	FORCE_INLINE static void Add(std::atomic<uint64>& counter, uint64 value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64> m_JobsExecuted{ 0 };
+	std::atomic<uint64> m_FibersCreated{ 0 };
+	std::atomic<uint64> m_FibersReused{ 0 };
+	std::atomic<uint64> m_ContextSwitches{ 0 };
+	std::atomic<uint64> m_Steals{ 0 };
+	alignas(64) Histogram m_QueueLatency[(int)Job::Priority::PRIO_MAX];
+	Histogram m_RunTime[(int)Job::Priority::PRIO_MAX];
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
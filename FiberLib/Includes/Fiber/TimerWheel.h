@@ -0,0 +1,79 @@
+// TimerWheel.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include <atomic>
+#include <chrono>
+
+class FiberJob;
+class FiberDesc;
+
+using TimerUS = std::chrono::microseconds;
+
+
+// struct TimerNode
+//------------------------------------------------------------------------------
+// Intrusive timer entry, embedded in the job or fiber it wakes up so arming a
+// timer never allocates.
+struct TimerNode
+{
+	TimerNode* m_Next{ nullptr };
+	uint64     m_DeadlineUS{ 0 };
+	FiberJob*  m_Job{ nullptr };
+	FiberDesc* m_Fiber{ nullptr };
+};
+
+
+// class TimerWheel
+//------------------------------------------------------------------------------
+// Hierarchical timer wheel with microsecond ticks, 6 levels of 64 slots. A
+// timer sits on the level where its deadline first differs from the wheel time
+// and moves down a level each time its slot comes up, so inserting is O(1) and
+// a timer is touched at most once per level before it expires. The next slot
+// to come up is found with a bit scan of each level's occupancy.
+//
+// Only the owner thread may Insert and Advance, other threads Post into a lock
+// free inbox the owner drains on its next Advance.
+class TimerWheel
+{
+public:
+	static constexpr uint32 SLOT_BITS = 6;
+	static constexpr uint32 SLOT_COUNT = 1 << SLOT_BITS;
+	static constexpr uint32 LEVEL_COUNT = 6;
+	static constexpr uint64 MAX_DELAY_US = ((uint64)1 << (SLOT_BITS * LEVEL_COUNT)) - 1;	// ~19 hours, later timers wait in an overflow list
+
+	TimerWheel();
+
+	TimerWheel(const TimerWheel&) = delete;
+
+	void       Insert(TimerNode* node);
+	void       Post(TimerNode* node);
+	// Expired timers in deadline order, linked through m_Next
+	TimerNode* Advance(uint64 nowUS);
+	// Time until the next slot comes up, 0 when something is due and ~0 when empty
+	uint64     GetRemainTime(uint64 nowUS) const;
+
+	FORCE_INLINE bool HasPosted() const { return m_Inbox.load(std::memory_order_acquire) != nullptr; }
+
+	static uint64 Now();
+	static uint64 NowNS();
+
+private:
+	bool NextExpiration(uint32& level, uint32& slot, uint64& deadlineUS) const;
+	void PushDue(TimerNode* node);
+	void DrainInbox();
+
+	TimerNode*              m_Slots[LEVEL_COUNT][SLOT_COUNT];
+	uint64                  m_Occupied[LEVEL_COUNT];
+	uint64                  m_ElapsedUS;
+	TimerNode*              m_DueHead;
+	TimerNode*              m_DueTail;
+	TimerNode*              m_Overflow;
+	std::atomic<TimerNode*> m_Inbox;
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
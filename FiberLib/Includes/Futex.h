@@ -0,0 +1,22 @@
+// Futex.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include <atomic>
+
+
+// namespace Futex
+//------------------------------------------------------------------------------
+// Wait on a 32 bit word until another thread wakes it, like the Linux futex.
+// Wait returns at once when the word no longer holds the expected value, and
+// may return spuriously, so callers always recheck their condition.
+namespace Futex
+{
+	void Wait(std::atomic<uint32>& word, uint32 expected, uint64 timeUS = 0);	// 0 waits without timeout
+	void Wake(std::atomic<uint32>& word, uint32 count = 1);
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
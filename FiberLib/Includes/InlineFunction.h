@@ -0,0 +1,143 @@
+// InlineFunction.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+template<class Signature, SIZET Capacity = 48>
+class InlineFunction;
+
+
+// class InlineFunction
+//------------------------------------------------------------------------------
+// Move only callable stored in place when it fits Capacity bytes, larger ones
+// fall back to the heap. A functor returning void can be stored in a non void
+// signature, it then returns a value initialized result. In a void signature the
+// result of a functor is dropped.
+template<class R, class... Args, SIZET Capacity>
+class InlineFunction<R(Args...), Capacity>
+{
+public:
+	InlineFunction() = default;
+	InlineFunction(std::nullptr_t) {}
+
+	template<class Functor, class = typename std::enable_if<!std::is_same<typename std::decay<Functor>::type, InlineFunction>::value>::type>
+	InlineFunction(Functor&& func)
+	{
+		using Type = typename std::decay<Functor>::type;
+		if constexpr (IsInline<Type>())
+		{
+			new (m_Storage) Type(std::forward<Functor>(func));
+			m_Invoke = &InvokeInline<Type>;
+			m_Manage = &ManageInline<Type>;
+		}
+		else
+		{
+			*reinterpret_cast<Type**>(m_Storage) = new Type(std::forward<Functor>(func));
+			m_Invoke = &InvokeHeap<Type>;
+			m_Manage = &ManageHeap<Type>;
+		}
+	}
+
+	InlineFunction(InlineFunction&& other) noexcept { MoveFrom(other); }
+	~InlineFunction() { Clear(); }
+
+	InlineFunction(const InlineFunction&) = delete;
+	InlineFunction& operator=(const InlineFunction&) = delete;
+
+	InlineFunction& operator=(InlineFunction&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Clear();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+	FORCE_INLINE R operator()(Args... args) { return m_Invoke(m_Storage, std::forward<Args>(args)...); }
+	FORCE_INLINE explicit operator bool() const { return m_Invoke != nullptr; }
+
+	template<class Functor>
+	static constexpr bool IsInline()
+	{
+		return sizeof(Functor) <= Capacity && alignof(Functor) <= alignof(std::max_align_t)
+			&& std::is_nothrow_move_constructible<Functor>::value;
+	}
+
+private:
+	enum class Operation : uint8 { MOVE, DESTROY };
+
+	using InvokeFunc = R (*)(void*, Args&&...);
+	using ManageFunc = void (*)(Operation, void*, void*);
+
+	template<class Functor>
+	static R Call(Functor& func, Args&&... args)
+	{
+		if constexpr (std::is_void<R>::value)
+			func(std::forward<Args>(args)...);
+		else if constexpr (!std::is_void<decltype(func(std::forward<Args>(args)...))>::value)
+			return func(std::forward<Args>(args)...);
+		else
+		{
+			func(std::forward<Args>(args)...);
+			return R();
+		}
+	}
+
+	template<class Functor>
+	static R InvokeInline(void* storage, Args&&... args) { return Call(*reinterpret_cast<Functor*>(storage), std::forward<Args>(args)...); }
+
+	template<class Functor>
+	static R InvokeHeap(void* storage, Args&&... args) { return Call(**reinterpret_cast<Functor**>(storage), std::forward<Args>(args)...); }
+
+	template<class Functor>
+	static void ManageInline(Operation op, void* dst, void* src)
+	{
+		Functor* func = reinterpret_cast<Functor*>(src);
+		if (op == Operation::MOVE)
+			new (dst) Functor(std::move(*func));
+		func->~Functor();
+	}
+
+	template<class Functor>
+	static void ManageHeap(Operation op, void* dst, void* src)
+	{
+		if (op == Operation::MOVE)
+			*reinterpret_cast<Functor**>(dst) = *reinterpret_cast<Functor**>(src);
+		else
+			delete *reinterpret_cast<Functor**>(src);
+	}
+
+	void MoveFrom(InlineFunction& other)
+	{
+		if (other.m_Manage)
+			other.m_Manage(Operation::MOVE, m_Storage, other.m_Storage);
+		m_Invoke = other.m_Invoke;
+		m_Manage = other.m_Manage;
+		other.m_Invoke = nullptr;
+		other.m_Manage = nullptr;
+	}
+
+	void Clear()
+	{
+		if (m_Manage)
+			m_Manage(Operation::DESTROY, nullptr, m_Storage);
+		m_Invoke = nullptr;
+		m_Manage = nullptr;
+	}
+
+	alignas(std::max_align_t) unsigned char m_Storage[Capacity];
+	InvokeFunc m_Invoke{ nullptr };
+	ManageFunc m_Manage{ nullptr };
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -6,7 +6,7 @@
 //------------------------------------------------------------------------------
 #include "Types.h"
 #include "Misc.h"
-#include <functional>
+#include "InlineFunction.h"
 #include <atomic>
 #include <assert.h>
 
@@ -39,6 +39,16 @@ public:
 		STATUS_EXPIRED		
 	};
 
+	// Minimum stack a job needs, sizes are configured on the scheduler
+	enum class StackSize : uint8
+	{
+		STACK_SMALL = 0,
+		STACK_MEDIUM,
+		STACK_LARGE,
+		STACK_MAX,
+		STACK_DEFAULT = STACK_MAX	// whatever the scheduler's default is
+	};
+
 	explicit Job();
 	virtual ~Job();
 
@@ -50,11 +60,19 @@ public:
 	FORCE_INLINE bool   IsRunning() const { return m_Status == Status::STATUS_RUNNING || m_Status == Status::STATUS_SUSPEND || m_Status == Status::STATUS_READY; }
 	FORCE_INLINE bool   IsValid() const { return m_Status != Status::STATUS_INVALID; }
 	FORCE_INLINE bool   IsReady() const { return m_Status == Status::STATUS_READY; }
+	FORCE_INLINE bool   IsAborted() const { return m_Aborted; }
 	FORCE_INLINE void   Reset() { m_Status = Status::STATUS_INVALID; }
 
 	FORCE_INLINE void   SetStatus(Status statu) { m_Status = statu; }
 	FORCE_INLINE uint8  GetPriority() const { return (uint8)m_Prio; }
+	FORCE_INLINE void   SetPriority(Priority prio) { m_Prio = prio; }
+	FORCE_INLINE uint8  GetStackSize() const { return (uint8)m_StackSize; }
+	FORCE_INLINE void   SetStackSize(StackSize size) { m_StackSize = size; }
+	FORCE_INLINE uint32 GetMaxPeriod() const { return m_MaxPeriod; }
+	FORCE_INLINE void   SetMaxPeriod(uint32 periodMS) { m_MaxPeriod = periodMS; }		// 0 never expires
 	FORCE_INLINE void   Abort() { m_Aborted = true; OnAborted(); }
+	FORCE_INLINE const char* GetName() const { return m_Name; }
+	FORCE_INLINE void   SetName(const char* name) { m_Name = name; }		// shows in traces, must outlive them
 
 	virtual int32 Excute() = 0;	
 
@@ -65,7 +83,10 @@ public:
 protected:
 	Status                 m_Status;
 	Priority               m_Prio;
+	StackSize              m_StackSize;
+	uint32                 m_MaxPeriod;
 	std::atomic<bool>      m_Aborted;
+	const char*            m_Name;
 };
 
 
@@ -75,32 +96,12 @@ class FuncJob : public Job
 {
 public:
 	template<typename Functor>
-	FuncJob(Functor&& f)
-	{
-		PRAGMA_DISABLE_PUSH_MSVC(4996);
-		if constexpr (std::is_same<typename std::result_of<Functor()>::type, void>::value)
-			m_NoneResultExecutor = std::forward<Functor>(f);
-		else
-			m_Executor = std::forward<Functor>(f);
-		PRAGMA_DISABLE_POP_MSVC(4996);
-	}
-
-	virtual int32 Excute() 
-	{
-		if (m_Executor)
-		{
-			return m_Executor();
-		}
-		else
-		{
-			m_NoneResultExecutor(); 
-			return 0;
-		}
-	}	
+	FuncJob(Functor&& f) : m_Executor(std::forward<Functor>(f)) {}
+
+	virtual int32 Excute() { return m_Executor(); }
 
 private:
-	std::function<int32()> m_Executor;
-	std::function<void()>  m_NoneResultExecutor;
+	InlineFunction<int32()> m_Executor;
 };
 
 // Class FuncCompletorJob
@@ -109,14 +110,14 @@ class FuncCompletorJob : public Job
 {
 public:
 	template<typename Functor>
-	FuncCompletorJob(Functor&& d1) : m_Completor(std::forward<Functor>(d1)), m_PreResult(0) {}
+	FuncCompletorJob(Functor&& d1) : m_PreResult(0), m_Completor(std::forward<Functor>(d1)) {}
 
 	virtual int32 Excute() { m_Completor(m_PreResult); return 0; }
-	virtual void  SetPreResult(bool preResult) { m_PreResult = preResult; }
+	virtual void  SetPreResult(int32 preResult) { m_PreResult = preResult; }
 
 private:
-	bool                       m_PreResult;
-	std::function<void(int32)> m_Completor;
+	int32                       m_PreResult;
+	InlineFunction<void(int32)> m_Completor;
 };
 
 
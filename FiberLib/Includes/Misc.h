@@ -24,12 +24,23 @@
 	#define DEPR			__declspec( deprecated )
 	#define NO_INLINE		__declspec( noinline )
 	#define FORCE_INLINE	__forceinline
-#elif defined(__APPLE__)
+#elif defined(__APPLE__) || defined(__LINUX__)
 	#define DEPR			__attribute__( deprecated )
 	#define NO_INLINE		inline __attribute__((noinline))
 	#define FORCE_INLINE	inline __attribute__((always_inline))
 #endif
 
+// Bit scan
+//------------------------------------------------------------------------------
+#if defined(__WINDOWS__)
+	#include <intrin.h>
+	#define CountTrailingZeros64(x)	_tzcnt_u64(x)
+	#define CountLeadingZeros64(x)	_lzcnt_u64(x)
+#else
+	#define CountTrailingZeros64(x)	__builtin_ctzll(x)
+	#define CountLeadingZeros64(x)	__builtin_clzll(x)
+#endif
+
 // Thread local
 //------------------------------------------------------------------------------
 #if defined(__WINDOWS__)
@@ -44,6 +55,18 @@
 	#define MemoryBarrier() __asm__ __volatile__("")
 #endif
 
+// Spin wait hint
+//------------------------------------------------------------------------------
+#if defined(__WINDOWS__)
+	#define CpuPause() _mm_pause()
+#elif defined(__x86_64__) || defined(__i386__)
+	#define CpuPause() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+	#define CpuPause() __asm__ __volatile__("yield")
+#else
+	#define CpuPause()
+#endif
+
 // Compile print
 //------------------------------------------------------------------------------
 #if defined __COMPILE_DEBUG__
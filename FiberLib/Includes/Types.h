@@ -7,6 +7,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include <stdint.h>
+#include <stddef.h>
 
 // Common types
 //------------------------------------------------------------------------------
@@ -34,6 +35,9 @@ typedef size_t				SIZET;
 #elif defined(__WIN32__)
 	typedef int32			INTPTR;
 	typedef uint32			UINTPTR;
+#else
+	typedef intptr_t		INTPTR;
+	typedef uintptr_t		UINTPTR;
 #endif
 
 
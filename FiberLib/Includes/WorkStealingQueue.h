@@ -0,0 +1,145 @@
+// WorkStealingQueue.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Types.h"
+#include "Misc.h"
+#include <atomic>
+#include <vector>
+
+
+// class WorkStealingQueue
+//------------------------------------------------------------------------------
+// Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak
+// Memory Models"). The owner thread pushes and pops at the bottom, any other
+// thread steals from the top. Items are raw pointers, ownership is managed by
+// the caller.
+template<class T>
+class WorkStealingQueue
+{
+public:
+	explicit WorkStealingQueue(int64 capacity = 256)
+		: m_Top(0)
+		, m_Bottom(0)
+		, m_Array(new Array(capacity))
+	{
+		ASSERT((capacity & (capacity - 1)) == 0);
+	}
+
+	~WorkStealingQueue()
+	{
+		for (Array* array : m_Garbage)
+			delete array;
+		delete m_Array.load(std::memory_order_relaxed);
+	}
+
+	WorkStealingQueue(const WorkStealingQueue&) = delete;
+	WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+	// Owner only
+	void Push(T* item)
+	{
+		int64 bottom = m_Bottom.load(std::memory_order_relaxed);
+		int64 top = m_Top.load(std::memory_order_acquire);
+		Array* array = m_Array.load(std::memory_order_relaxed);
+		if (bottom - top > array->m_Mask)
+			array = Grow(array, bottom, top);
+		array->Put(bottom, item);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	// Owner only, publishes all items with a single store
+	void PushRange(T* const* items, int64 count)
+	{
+		int64 bottom = m_Bottom.load(std::memory_order_relaxed);
+		int64 top = m_Top.load(std::memory_order_acquire);
+		Array* array = m_Array.load(std::memory_order_relaxed);
+		while (bottom - top + count > array->m_Mask + 1)
+			array = Grow(array, bottom, top);
+		for (int64 i = 0; i < count; ++i)
+			array->Put(bottom + i, items[i]);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + count, std::memory_order_relaxed);
+	}
+
+	// Owner only
+	T* Pop()
+	{
+		int64 bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		Array* array = m_Array.load(std::memory_order_relaxed);
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64 top = m_Top.load(std::memory_order_relaxed);
+
+		T* item = nullptr;
+		if (top <= bottom)
+		{
+			item = array->Get(bottom);
+			if (top == bottom)
+			{
+				// Last item, race against thieves
+				if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					item = nullptr;
+				m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// Any thread, may spuriously fail under contention
+	T* Steal()
+	{
+		int64 top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64 bottom = m_Bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return nullptr;
+
+		Array* array = m_Array.load(std::memory_order_acquire);
+		T* item = array->Get(top);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return item;
+	}
+
+	FORCE_INLINE bool  IsEmpty() const { return Size() <= 0; }
+	FORCE_INLINE int64 Size() const { return m_Bottom.load(std::memory_order_relaxed) - m_Top.load(std::memory_order_relaxed); }
+
+private:
+	struct Array
+	{
+		explicit Array(int64 capacity) : m_Mask(capacity - 1), m_Items(new std::atomic<T*>[capacity]) {}
+		~Array() { delete[] m_Items; }
+
+		FORCE_INLINE T*   Get(int64 index) const { return m_Items[index & m_Mask].load(std::memory_order_relaxed); }
+		FORCE_INLINE void Put(int64 index, T* item) { m_Items[index & m_Mask].store(item, std::memory_order_relaxed); }
+
+		int64            m_Mask;
+		std::atomic<T*>* m_Items;
+	};
+
+	Array* Grow(Array* array, int64 bottom, int64 top)
+	{
+		Array* newArray = new Array((array->m_Mask + 1) * 2);
+		for (int64 i = top; i < bottom; ++i)
+			newArray->Put(i, array->Get(i));
+		// Thieves may still read the old array, it is released with the queue
+		m_Garbage.push_back(array);
+		m_Array.store(newArray, std::memory_order_release);
+		return newArray;
+	}
+
+	alignas(64) std::atomic<int64>  m_Top;
+	alignas(64) std::atomic<int64>  m_Bottom;
+	std::atomic<Array*>             m_Array;
+	std::vector<Array*>             m_Garbage;
+};
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -9,9 +9,11 @@
 #include "Misc.h"
 #include "Types.h"
 #include <atomic>
+#include <string>
+#include <mutex>
 #include <shared_mutex>
-#include <condition_variable>
 #include <thread>
+#include <vector>
 
 #define THREAD_COUNT_MIN (sizeof(char) * 8)
 #define THREAD_COUNT_MAX (sizeof(uint64) * 8)
@@ -58,9 +60,16 @@ public:
 	virtual ~ThreadWorker();
 
 	void Init();
-	void SetAffinityMask(uint64 mask);
-
-	void Sleep(std::unique_lock<std::mutex>& lock, uint32 timeMS = 0);
+	// Pins the thread to the CPUs, none lets it run on any. Set before Init, the thread applies it
+	// itself before running Main.
+	bool SetAffinity(const std::vector<uint32>& cpus);
+	// CPUs 0-63 by bit
+	bool SetAffinityMask(uint64 mask);
+
+	// Parking is two steps so the caller can recheck for work in between, a WakeUp after
+	// PrepareToPark makes Park return at once
+	void PrepareToPark();
+	void Park(uint64 timeUS = 0);
 	void WakeUp();
 
 	FORCE_INLINE void               SetStopped() { m_Stopped = true; };
@@ -69,21 +78,33 @@ public:
 	FORCE_INLINE uint32             GetThreadID() const { return m_ThreadID; }
 	FORCE_INLINE uint64             GetThreadFilterID() const { return m_ThreadFilterID; }
 	FORCE_INLINE const std::string& GetThreadName() const { return m_ThreadName; }
+	FORCE_INLINE const std::vector<uint32>& GetAffinity() const { return m_Affinity; }
 
 	static uint32        GetCurrentThreadID();
 	static uint64        GetCurrentThreadFilter();
 	static ThreadWorker* GetCurrentThreadWorker();
 
 protected:
+	enum ParkState : uint32
+	{
+		PARK_RUNNING = 0,
+		PARK_PARKED
+	};
+
 	static uint32 ThreadWrapperFunc(void* param);
 	virtual void  Main() = 0;
+	// How a parked worker sleeps and is woken, a futex on m_ParkState by default
+	virtual void  WaitForWakeUp(uint64 timeUS);
+	virtual void  SignalWakeUp();
+	bool          ApplyAffinity();
 
 protected:  
 	std::string             m_ThreadName;
 	uint32                  m_ThreadID;
 	uint64                  m_ThreadFilterID;
 	std::thread             m_Thread;
-	std::condition_variable m_CV;
+	std::atomic<uint32>     m_ParkState;
+	std::vector<uint32>     m_Affinity;		// empty when not pinned
 
 	std::atomic<bool> m_Stopped;
 	std::atomic<bool> m_Exited;
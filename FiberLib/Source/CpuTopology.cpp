@@ -0,0 +1,252 @@
+// CpuTopology.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CpuTopology.h"
+#include <algorithm>
+#include <ctype.h>
+#include <fstream>
+#include <map>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#if defined(__LINUX__)
+	#include <dirent.h>
+	#include <sched.h>
+#endif
+
+// Static
+//------------------------------------------------------------------------------
+// CPUs without an L3 entry fall back to their package, kept apart from the CPU numbers
+static const uint32 PACKAGE_KEY = 0x8000'0000;
+
+static std::string ReadLine(const std::string& path)
+{
+	std::ifstream file(path);
+	std::string line;
+	std::getline(file, line);
+	return line;
+}
+
+
+/*static*/ const CpuTopology& CpuTopology::Get()
+{
+	static const CpuTopology s_Topology = []() {
+		CpuTopology topology;
+#if defined(__LINUX__)
+		topology = Load("/sys/devices/system");
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		{
+			std::vector<uint32> allowed;
+			for (uint32 cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+				if (CPU_ISSET(cpu, &set))
+					allowed.push_back(cpu);
+			topology.Keep(allowed);
+		}
+#endif
+		if (topology.m_Cpus.empty())
+			topology = Flat(TMAX(std::thread::hardware_concurrency(), 1u));
+		return topology;
+	}();
+	return s_Topology;
+}
+
+/*static*/ CpuTopology CpuTopology::Load(const std::string& root)
+{
+	CpuTopology topology;
+	std::string cpuRoot = root + "/cpu/cpu";
+	for (uint32 cpu : ParseCpuList(ReadLine(root + "/cpu/online")))
+	{
+		std::string path = cpuRoot + std::to_string(cpu);
+		CpuInfo info{ cpu, cpu, 0, 0, 0 };
+
+		// A core is named by its first SMT sibling, an L3 domain by the first CPU sharing it
+		std::vector<uint32> siblings = ParseCpuList(ReadLine(path + "/topology/thread_siblings_list"));
+		if (!siblings.empty())
+			info.m_Core = siblings.front();
+
+		std::string package = ReadLine(path + "/topology/physical_package_id");
+		info.m_L3 = PACKAGE_KEY | (uint32)atoi(package.c_str());
+		for (uint32 index = 0; index < 16; ++index)
+		{
+			std::string cache = path + "/cache/index" + std::to_string(index);
+			std::string level = ReadLine(cache + "/level");
+			if (level.empty())
+				break;
+			std::vector<uint32> shared = ParseCpuList(ReadLine(cache + "/shared_cpu_list"));
+			if (level == "3" && !shared.empty())
+			{
+				info.m_L3 = shared.front();
+				break;
+			}
+		}
+		topology.m_Cpus.push_back(info);
+	}
+
+#if defined(__LINUX__)
+	// Nodes list their CPUs, without the directory everything is node 0
+	if (DIR* dir = opendir((root + "/node").c_str()))
+	{
+		while (dirent* entry = readdir(dir))
+		{
+			if (strncmp(entry->d_name, "node", 4) != 0 || entry->d_name[4] < '0' || entry->d_name[4] > '9')
+				continue;
+			uint32 node = (uint32)atoi(entry->d_name + 4);
+			for (uint32 cpu : ParseCpuList(ReadLine(root + "/node/" + entry->d_name + "/cpulist")))
+			{
+				auto it = std::lower_bound(topology.m_Cpus.begin(), topology.m_Cpus.end(), cpu, [](const CpuInfo& info, uint32 value) { return info.m_Cpu < value; });
+				if (it != topology.m_Cpus.end() && it->m_Cpu == cpu)
+					it->m_Node = node;
+			}
+		}
+		closedir(dir);
+	}
+#endif
+
+	topology.Finish();
+	return topology;
+}
+
+/*static*/ CpuTopology CpuTopology::Flat(uint32 count)
+{
+	CpuTopology topology;
+	for (uint32 cpu = 0; cpu < count; ++cpu)
+		topology.m_Cpus.push_back(CpuInfo{ cpu, cpu, 0, 0, 0 });
+	topology.Finish();
+	return topology;
+}
+
+const CpuTopology::CpuInfo* CpuTopology::Find(uint32 cpu) const
+{
+	auto it = std::lower_bound(m_Cpus.begin(), m_Cpus.end(), cpu, [](const CpuInfo& info, uint32 value) { return info.m_Cpu < value; });
+	return it != m_Cpus.end() && it->m_Cpu == cpu ? &*it : nullptr;
+}
+
+CpuTopology::Distance CpuTopology::GetDistance(uint32 cpuA, uint32 cpuB) const
+{
+	const CpuInfo* a = Find(cpuA);
+	const CpuInfo* b = Find(cpuB);
+	if (!a || !b)
+		return REMOTE;
+	if (a->m_Core == b->m_Core)
+		return SAME_CORE;
+	if (a->m_L3 == b->m_L3)
+		return SAME_L3;
+	return a->m_Node == b->m_Node ? SAME_NODE : REMOTE;
+}
+
+std::vector<std::vector<uint32>> CpuTopology::Place(AffinityPolicy policy, uint32 count) const
+{
+	std::vector<std::vector<uint32>> placement(count);
+	if (policy == AffinityPolicy::NONE || m_Cpus.empty())
+		return placement;
+
+	// Neighbours next to each other: by node, L3, core, then sibling
+	std::vector<CpuInfo> compact = m_Cpus;
+	std::sort(compact.begin(), compact.end(), [](const CpuInfo& a, const CpuInfo& b) {
+		if (a.m_Node != b.m_Node) return a.m_Node < b.m_Node;
+		if (a.m_L3 != b.m_L3) return a.m_L3 < b.m_L3;
+		if (a.m_Core != b.m_Core) return a.m_Core < b.m_Core;
+		return a.m_Thread < b.m_Thread;
+	});
+
+	if (policy == AffinityPolicy::ONE_PER_CORE)
+	{
+		std::vector<std::vector<uint32>> cores;
+		for (SIZET i = 0; i < compact.size(); ++i)
+		{
+			if (i == 0 || compact[i].m_Core != compact[i - 1].m_Core)
+				cores.emplace_back();
+			cores.back().push_back(compact[i].m_Cpu);
+		}
+		for (uint32 i = 0; i < count; ++i)
+			placement[i] = cores[i % cores.size()];
+		return placement;
+	}
+
+	std::vector<uint32> order;
+	if (policy == AffinityPolicy::COMPACT)
+	{
+		for (const CpuInfo& info : compact)
+			order.push_back(info.m_Cpu);
+	}
+	else
+	{
+		// Deal the L3 domains out in turn, each giving the first sibling of all its cores before any second one
+		std::vector<std::vector<CpuInfo>> domains;
+		for (SIZET i = 0; i < compact.size(); ++i)
+		{
+			if (i == 0 || compact[i].m_L3 != compact[i - 1].m_L3)
+				domains.emplace_back();
+			domains.back().push_back(compact[i]);
+		}
+		SIZET rounds = 0;
+		for (auto& domain : domains)
+		{
+			std::stable_sort(domain.begin(), domain.end(), [](const CpuInfo& a, const CpuInfo& b) { return a.m_Thread < b.m_Thread; });
+			rounds = TMAX(rounds, domain.size());
+		}
+		for (SIZET round = 0; round < rounds; ++round)
+			for (auto& domain : domains)
+				if (round < domain.size())
+					order.push_back(domain[round].m_Cpu);
+	}
+	for (uint32 i = 0; i < count; ++i)
+		placement[i].push_back(order[i % order.size()]);
+	return placement;
+}
+
+/*static*/ std::vector<uint32> CpuTopology::ParseCpuList(const std::string& text)
+{
+	std::vector<uint32> cpus;
+	SIZET pos = 0;
+	while (pos < text.size())
+	{
+		SIZET end = text.find(',', pos);
+		if (end == std::string::npos)
+			end = text.size();
+		std::string range = text.substr(pos, end - pos);
+		SIZET dash = range.find('-');
+		if (!range.empty() && isdigit((unsigned char)range[0]))
+		{
+			uint32 first = (uint32)atoi(range.c_str());
+			uint32 last = dash == std::string::npos ? first : (uint32)atoi(range.c_str() + dash + 1);
+			for (uint32 cpu = first; cpu <= last; ++cpu)
+				cpus.push_back(cpu);
+		}
+		pos = end + 1;
+	}
+	return cpus;
+}
+
+void CpuTopology::Keep(const std::vector<uint32>& allowed)
+{
+	m_Cpus.erase(std::remove_if(m_Cpus.begin(), m_Cpus.end(), [&allowed](const CpuInfo& info) {
+		return std::find(allowed.begin(), allowed.end(), info.m_Cpu) == allowed.end();
+	}), m_Cpus.end());
+	Finish();
+}
+
+void CpuTopology::Finish()
+{
+	// Renumber cores, domains and nodes densely, and the siblings within each core from 0
+	std::sort(m_Cpus.begin(), m_Cpus.end(), [](const CpuInfo& a, const CpuInfo& b) { return a.m_Cpu < b.m_Cpu; });
+	std::map<uint32, uint32> cores, domains, nodes;
+	std::map<uint32, uint32> threads;
+	for (CpuInfo& info : m_Cpus)
+	{
+		info.m_Core = cores.emplace(info.m_Core, (uint32)cores.size()).first->second;
+		info.m_L3 = domains.emplace(info.m_L3, (uint32)domains.size()).first->second;
+		info.m_Node = nodes.emplace(info.m_Node, (uint32)nodes.size()).first->second;
+		info.m_Thread = threads[info.m_Core]++;
+	}
+	m_CoreCount = (uint32)cores.size();
+	m_L3Count = (uint32)domains.size();
+	m_NodeCount = (uint32)nodes.size();
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -4,12 +4,18 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Fiber/Fiber.h"
+#include "Misc.h"
 
 #if defined(__WINDOWS__)
 	#include <windows.h>
+#elif defined(__LINUX__)
+	#include <stdlib.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
 #endif
 
 
+#if defined(__WINDOWS__)
 //------------------------------------------------------------------------------
 namespace Fiber
 {
@@ -18,9 +24,15 @@ namespace Fiber
 		return ::ConvertThreadToFiber(nullptr);
 	}
 
+	void  ReleaseFromThread()
+	{
+		::ConvertFiberToThread();
+	}
+
 	void* CreateFiber(int stacksize, FiberProc proc, void* parameter)
 	{
-		return ::CreateFiber(stacksize, proc, parameter);
+		// Reserve the whole stack but only commit the first page, the system adds the guard page
+		return ::CreateFiberEx(4 * KILOBYTE, stacksize, 0, proc, parameter);
 	}
 
 	void  DestroyFiber(void* fiber)
@@ -32,6 +44,245 @@ namespace Fiber
 	{
 		::SwitchToFiber(fiber);
 	}
+
+	SIZET ReleaseUnusedStack(void* fiber)
+	{
+		return 0;
+	}
+}
+
+#elif defined(__LINUX__)
+// Context switch
+//------------------------------------------------------------------------------
+// Only the callee-saved registers of the platform ABI are stored on the stack
+// of the fiber being left, the stack pointer is written to *from and the one
+// of the target fiber is loaded. No signal mask is touched, so unlike
+// swapcontext no syscall happens on a switch.
+//
+// A fresh fiber stack is prepared so that the first switch "returns" into
+// FiberLib_StartContext, which calls entry(context) from the saved registers.
+extern "C"
+{
+	void FiberLib_SwitchContext(void** from, void* to);
+	void FiberLib_StartContext();
+}
+
+#if defined(__x86_64__)
+	// MXCSR/x87 control word, r15-r12, rbx, rbp and the return address (System V AMD64)
+	#define FIBER_CONTEXT_SIZE	(8 * 8)
+	__asm__(
+		".text\n"
+		".globl FiberLib_SwitchContext\n"
+		".hidden FiberLib_SwitchContext\n"
+		".type FiberLib_SwitchContext, @function\n"
+		".align 16\n"
+		"FiberLib_SwitchContext:\n"
+		"	pushq %rbp\n"
+		"	pushq %rbx\n"
+		"	pushq %r12\n"
+		"	pushq %r13\n"
+		"	pushq %r14\n"
+		"	pushq %r15\n"
+		"	subq $8, %rsp\n"
+		"	stmxcsr (%rsp)\n"
+		"	fnstcw 4(%rsp)\n"
+		"	movq %rsp, (%rdi)\n"
+		"	movq %rsi, %rsp\n"
+		"	ldmxcsr (%rsp)\n"
+		"	fldcw 4(%rsp)\n"
+		"	addq $8, %rsp\n"
+		"	popq %r15\n"
+		"	popq %r14\n"
+		"	popq %r13\n"
+		"	popq %r12\n"
+		"	popq %rbx\n"
+		"	popq %rbp\n"
+		"	ret\n"
+		".size FiberLib_SwitchContext, .-FiberLib_SwitchContext\n"
+
+		".globl FiberLib_StartContext\n"
+		".hidden FiberLib_StartContext\n"
+		".type FiberLib_StartContext, @function\n"
+		".align 16\n"
+		"FiberLib_StartContext:\n"
+		"	movq %r12, %rdi\n"
+		"	callq *%r13\n"
+		"	ud2\n"
+		".size FiberLib_StartContext, .-FiberLib_StartContext\n"
+	);
+#elif defined(__aarch64__)
+	// x19-x30 and d8-d15 (AAPCS64)
+	#define FIBER_CONTEXT_SIZE	(20 * 8)
+	__asm__(
+		".text\n"
+		".globl FiberLib_SwitchContext\n"
+		".hidden FiberLib_SwitchContext\n"
+		".type FiberLib_SwitchContext, %function\n"
+		".align 4\n"
+		"FiberLib_SwitchContext:\n"
+		"	sub sp, sp, #160\n"
+		"	stp x19, x20, [sp, #0]\n"
+		"	stp x21, x22, [sp, #16]\n"
+		"	stp x23, x24, [sp, #32]\n"
+		"	stp x25, x26, [sp, #48]\n"
+		"	stp x27, x28, [sp, #64]\n"
+		"	stp x29, x30, [sp, #80]\n"
+		"	stp d8,  d9,  [sp, #96]\n"
+		"	stp d10, d11, [sp, #112]\n"
+		"	stp d12, d13, [sp, #128]\n"
+		"	stp d14, d15, [sp, #144]\n"
+		"	mov x2, sp\n"
+		"	str x2, [x0]\n"
+		"	mov sp, x1\n"
+		"	ldp x19, x20, [sp, #0]\n"
+		"	ldp x21, x22, [sp, #16]\n"
+		"	ldp x23, x24, [sp, #32]\n"
+		"	ldp x25, x26, [sp, #48]\n"
+		"	ldp x27, x28, [sp, #64]\n"
+		"	ldp x29, x30, [sp, #80]\n"
+		"	ldp d8,  d9,  [sp, #96]\n"
+		"	ldp d10, d11, [sp, #112]\n"
+		"	ldp d12, d13, [sp, #128]\n"
+		"	ldp d14, d15, [sp, #144]\n"
+		"	add sp, sp, #160\n"
+		"	ret\n"
+		".size FiberLib_SwitchContext, .-FiberLib_SwitchContext\n"
+
+		".globl FiberLib_StartContext\n"
+		".hidden FiberLib_StartContext\n"
+		".type FiberLib_StartContext, %function\n"
+		".align 4\n"
+		"FiberLib_StartContext:\n"
+		"	mov x0, x19\n"
+		"	blr x20\n"
+		"	brk #0\n"
+		".size FiberLib_StartContext, .-FiberLib_StartContext\n"
+	);
+#else
+	#error "Fiber context switch is not implemented for this architecture"
+#endif
+
+
+// struct FiberContext
+//------------------------------------------------------------------------------
+struct FiberContext
+{
+	void*            m_StackPointer{ nullptr };
+	void*            m_Mapping{ nullptr };		// guard page followed by the stack
+	void*            m_Stack{ nullptr };
+	SIZET            m_StackSize{ 0 };
+	Fiber::FiberProc m_Proc{ nullptr };
+	void*            m_Parameter{ nullptr };
+};
+
+static THREAD_LOCAL FiberContext* s_CurrentFiber = nullptr;
+static const SIZET                s_PageSize = (SIZET)sysconf(_SC_PAGESIZE);
+
+
+static void FiberEntry(FiberContext* context)
+{
+	context->m_Proc(context->m_Parameter);
+
+	// Like a win32 fiber, a fiber proc must switch away instead of returning
+	ASSERT(false);
+	abort();
+}
+
+static void* PrepareStack(FiberContext* context)
+{
+	UINTPTR top = ((UINTPTR)context->m_Stack + context->m_StackSize) & ~(UINTPTR)15;
+	uint64* sp = (uint64*)(top - FIBER_CONTEXT_SIZE - 16);
+	for (int i = 0; i < (FIBER_CONTEXT_SIZE + 16) / 8; ++i)
+		sp[i] = 0;
+
+#if defined(__x86_64__)
+	sp[0] = 0x1F80 | ((uint64)0x037F << 32);	// default MXCSR | x87 control word
+	sp[3] = (uint64)(UINTPTR)FiberEntry;		// r13
+	sp[4] = (uint64)(UINTPTR)context;			// r12
+	sp[6] = 0;									// rbp
+	sp[7] = (uint64)(UINTPTR)FiberLib_StartContext;
+#elif defined(__aarch64__)
+	sp[0]  = (uint64)(UINTPTR)context;			// x19
+	sp[1]  = (uint64)(UINTPTR)FiberEntry;		// x20
+	sp[10] = 0;									// x29
+	sp[11] = (uint64)(UINTPTR)FiberLib_StartContext;	// x30
+#endif
+	return sp;
 }
 
+
+//------------------------------------------------------------------------------
+namespace Fiber
+{
+	void* InitFromThread()
+	{
+		ASSERT(!s_CurrentFiber);
+		s_CurrentFiber = new FiberContext();
+		return s_CurrentFiber;
+	}
+
+	void  ReleaseFromThread()
+	{
+		delete s_CurrentFiber;
+		s_CurrentFiber = nullptr;
+	}
+
+	void* CreateFiber(int stacksize, FiberProc proc, void* parameter)
+	{
+		// Pages are only committed once touched, an overflow hits the PROT_NONE guard page
+		SIZET size = ((SIZET)stacksize + s_PageSize - 1) & ~(s_PageSize - 1);
+		void* mapping = ::mmap(nullptr, size + s_PageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+		if (mapping == MAP_FAILED)
+			return nullptr;
+		// A stack without its guard page would overflow silently
+		if (::mprotect(mapping, s_PageSize, PROT_NONE) != 0)
+		{
+			::munmap(mapping, size + s_PageSize);
+			return nullptr;
+		}
+
+		FiberContext* context = new FiberContext();
+		context->m_Mapping = mapping;
+		context->m_Stack = (uint8*)mapping + s_PageSize;
+		context->m_StackSize = size;
+		context->m_Proc = proc;
+		context->m_Parameter = parameter;
+		context->m_StackPointer = PrepareStack(context);
+		return context;
+	}
+
+	void  DestroyFiber(void* fiber)
+	{
+		FiberContext* context = (FiberContext*)fiber;
+		ASSERT(context != s_CurrentFiber);
+		if (context->m_Mapping)
+			::munmap(context->m_Mapping, context->m_StackSize + s_PageSize);
+		delete context;
+	}
+
+	void  SwitchTo(void* fiber)
+	{
+		FiberContext* from = s_CurrentFiber;
+		FiberContext* to = (FiberContext*)fiber;
+		ASSERT(from && from != to);
+		s_CurrentFiber = to;
+		FiberLib_SwitchContext(&from->m_StackPointer, to->m_StackPointer);
+	}
+
+	SIZET ReleaseUnusedStack(void* fiber)
+	{
+		// Everything below the saved stack pointer of a switched out fiber is dead,
+		// keep one page below it and hand the rest back to the system
+		FiberContext* context = (FiberContext*)fiber;
+		ASSERT(context != s_CurrentFiber && context->m_Mapping);
+		UINTPTR low = (UINTPTR)context->m_Stack;
+		UINTPTR high = ((UINTPTR)context->m_StackPointer - s_PageSize) & ~(UINTPTR)(s_PageSize - 1);
+		if (high <= low)
+			return 0;
+		::madvise((void*)low, high - low, MADV_DONTNEED);
+		return high - low;
+	}
+}
+#endif
+
 //------------------------------------------------------------------------------
\ No newline at end of file
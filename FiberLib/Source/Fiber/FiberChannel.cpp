@@ -0,0 +1,42 @@
+// FiberChannel.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/FiberChannel.h"
+
+
+void ChannelBase::Close()
+{
+	m_Closed.store(true, std::memory_order_seq_cst);
+	// A waiter registers under its queue lock and checks the flag there, so it is either taken here or doesn't park
+	for (WaitList& list : m_Waiters)
+	{
+		list.m_Queue.Lock();
+		FiberWaiter* waiters = list.m_Queue.PopAll();
+		list.m_Count.store(0, std::memory_order_relaxed);
+		list.m_Queue.Unlock();
+		FiberWaitQueue::ResumeAll(waiters);
+	}
+}
+
+void ChannelBase::Notify(Side side, uint32 count)
+{
+	WaitList& list = m_Waiters[side];
+	// Pairs with the fence in Wait, after the transfer we either see the waiter or it sees the transfer
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (count == 0 || list.m_Count.load(std::memory_order_relaxed) == 0)
+		return;
+
+	FiberWaitQueue resumed;
+	list.m_Queue.Lock();
+	for (; count > 0 && !list.m_Queue.IsEmpty(); --count)
+	{
+		resumed.Push(list.m_Queue.Pop());
+		list.m_Count.fetch_sub(1, std::memory_order_relaxed);
+	}
+	list.m_Queue.Unlock();
+	FiberWaitQueue::ResumeAll(resumed.PopAll());
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,681 @@
+// FiberIO.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/FiberIO.h"
+#include "Fiber/FiberScheduler.h"
+#include "Fiber/FiberWorker.h"
+#include <errno.h>
+
+#if defined(__LINUX__)
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+	#include <sys/mman.h>
+	#include <sys/socket.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+	#include <linux/io_uring.h>
+	#include <linux/time_types.h>
+#elif !defined(__WINDOWS__)
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+#endif
+
+
+#if defined(__LINUX__)
+
+// Static
+//------------------------------------------------------------------------------
+#ifndef IORING_SETUP_SINGLE_ISSUER
+	#define IORING_SETUP_SINGLE_ISSUER (1U << 12)
+#endif
+
+
+IoRing::IoRing()
+	: m_Fd(-1)
+	, m_Features(0)
+	, m_SqRing(MAP_FAILED)
+	, m_CqRing(MAP_FAILED)
+	, m_Entries(MAP_FAILED)
+	, m_SqRingSize(0)
+	, m_CqRingSize(0)
+	, m_EntriesSize(0)
+	, m_SqTail(nullptr)
+	, m_SqHead(nullptr)
+	, m_SqMask(0)
+	, m_SqCount(0)
+	, m_CqHead(nullptr)
+	, m_CqTail(nullptr)
+	, m_CqMask(0)
+	, m_CqCount(0)
+	, m_Completions(nullptr)
+	, m_Tail(0)
+	, m_Queued(0)
+	, m_InFlight(0)
+	, m_Tick(0)
+{
+}
+
+IoRing::~IoRing()
+{
+	// Closing the ring cancels what is still in flight
+	if (m_Entries != MAP_FAILED)
+		munmap(m_Entries, m_EntriesSize);
+	if (m_CqRing != MAP_FAILED && m_CqRing != m_SqRing)
+		munmap(m_CqRing, m_CqRingSize);
+	if (m_SqRing != MAP_FAILED)
+		munmap(m_SqRing, m_SqRingSize);
+	if (m_Fd >= 0)
+		close(m_Fd);
+}
+
+bool IoRing::Init(uint32 entries)
+{
+	ASSERT(m_Fd < 0);
+	io_uring_params params = {};
+	params.flags = IORING_SETUP_SINGLE_ISSUER;
+	int32 fd = (int32)syscall(__NR_io_uring_setup, entries, &params);
+	if (fd < 0 && errno == EINVAL)
+	{
+		// Kernels before 6.0 don't know the single issuer hint
+		params = {};
+		fd = (int32)syscall(__NR_io_uring_setup, entries, &params);
+	}
+	if (fd < 0)
+		return false;
+
+	m_Fd = fd;
+	m_Features = params.features;
+	m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32);
+	m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (m_Features & IORING_FEAT_SINGLE_MMAP)
+	{
+		m_SqRingSize = TMAX(m_SqRingSize, m_CqRingSize);
+		m_CqRingSize = m_SqRingSize;
+	}
+	m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQ_RING);
+	if (m_Features & IORING_FEAT_SINGLE_MMAP)
+		m_CqRing = m_SqRing;
+	else
+		m_CqRing = mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_CQ_RING);
+	m_EntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+	m_Entries = mmap(nullptr, m_EntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQES);
+	if (m_SqRing == MAP_FAILED || m_CqRing == MAP_FAILED || m_Entries == MAP_FAILED)
+	{
+		// What did get mapped goes with the destructor
+		close(m_Fd);
+		m_Fd = -1;
+		return false;
+	}
+
+	uint8* sqRing = (uint8*)m_SqRing;
+	uint8* cqRing = (uint8*)m_CqRing;
+	m_SqHead = (uint32*)(sqRing + params.sq_off.head);
+	m_SqTail = (uint32*)(sqRing + params.sq_off.tail);
+	m_SqMask = *(uint32*)(sqRing + params.sq_off.ring_mask);
+	m_SqCount = params.sq_entries;
+	m_CqHead = (uint32*)(cqRing + params.cq_off.head);
+	m_CqTail = (uint32*)(cqRing + params.cq_off.tail);
+	m_CqMask = *(uint32*)(cqRing + params.cq_off.ring_mask);
+	m_CqCount = params.cq_entries;
+	m_Completions = cqRing + params.cq_off.cqes;
+	m_Tail = *m_SqTail;
+
+	// Entries are always used in ring order, so the index array maps each slot to itself
+	uint32* indices = (uint32*)(sqRing + params.sq_off.array);
+	for (uint32 i = 0; i < m_SqCount; ++i)
+		indices[i] = i;
+	return true;
+}
+
+bool IoRing::Queue(IoRequest* request, uint8 opcode, int32 fd, const void* addr, uint32 len, uint64 offset, uint32 flags)
+{
+	// Without a slot for each completion the kernel would have to hold them back
+	if (m_InFlight + 1 >= m_CqCount)
+		return false;
+
+	io_uring_sqe* entry = (io_uring_sqe*)NextEntry();
+	entry->opcode = opcode;
+	entry->fd = fd;
+	entry->addr = (uint64)(uintptr_t)addr;
+	entry->len = len;
+	entry->off = offset;
+	entry->rw_flags = (int32)flags;
+	entry->user_data = (uint64)(uintptr_t)request;
+	++m_InFlight;
+	return true;
+}
+
+void IoRing::Submit(bool flush)
+{
+	// A short batch still goes once it has waited SUBMIT_INTERVAL calls, a worker that never
+	// runs out of jobs would otherwise keep it queued for good
+	if (m_Queued == 0 || (!flush && m_Queued < SUBMIT_BATCH && ++m_Tick < SUBMIT_INTERVAL))
+		return;
+	m_Tick = 0;
+	__atomic_store_n(m_SqTail, m_Tail, __ATOMIC_RELEASE);
+	int32 submitted = Enter(m_Queued);
+	if (submitted > 0)
+		m_Queued -= (uint32)submitted;
+}
+
+IoRequest* IoRing::Reap()
+{
+	uint32 head = *m_CqHead;
+	uint32 tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+	IoRequest* first = nullptr;
+	IoRequest* last = nullptr;
+	for (; head != tail; ++head)
+	{
+		const io_uring_cqe& completion = ((const io_uring_cqe*)m_Completions)[head & m_CqMask];
+		IoRequest* request = (IoRequest*)(uintptr_t)completion.user_data;
+		request->m_Result = completion.res;
+		request->m_Next = nullptr;
+		if (last)
+			last->m_Next = request;
+		else
+			first = request;
+		last = request;
+		--m_InFlight;
+	}
+	__atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+	return first;
+}
+
+bool IoRing::HasCompletions() const
+{
+	return __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE) != *m_CqHead;
+}
+
+void* IoRing::NextEntry()
+{
+	if (m_Tail - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE) >= m_SqCount)
+		Submit(true);
+
+	io_uring_sqe* entry = &((io_uring_sqe*)m_Entries)[m_Tail & m_SqMask];
+	*entry = {};
+	++m_Tail;
+	++m_Queued;
+	return entry;
+}
+
+int32 IoRing::Enter(uint32 submit)
+{
+	int32 result = 0;
+	do
+	{
+		result = (int32)syscall(__NR_io_uring_enter, m_Fd, submit, 0, 0, nullptr, 0);
+	} while (result < 0 && errno == EINTR);
+	return result;
+}
+
+
+Reactor::Reactor()
+	: m_Fd(-1)
+	, m_WakeFd(-1)
+	, m_RingFd(-1)
+	, m_Waiting(0)
+	, m_Tick(0)
+	, m_Ready(nullptr)
+	, m_ReadyTail(nullptr)
+{
+}
+
+Reactor::~Reactor()
+{
+	if (m_Fd >= 0)
+		close(m_Fd);
+	if (m_WakeFd >= 0)
+		close(m_WakeFd);
+}
+
+bool Reactor::Init()
+{
+	ASSERT(m_Fd < 0);
+	m_WakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_WakeFd < 0)
+		return false;
+	int32 fd = epoll_create1(EPOLL_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	epoll_event event = {};
+	event.events = EPOLLIN | EPOLLET;
+	event.data.fd = m_WakeFd;
+	if (epoll_ctl(fd, EPOLL_CTL_ADD, m_WakeFd, &event) < 0)
+	{
+		close(fd);
+		return false;
+	}
+	m_Fd = fd;
+	return true;
+}
+
+void Reactor::WatchRing(int32 ringFd)
+{
+	// Level triggered, the ring stays readable as long as completions wait in it
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = ringFd;
+	if (epoll_ctl(m_Fd, EPOLL_CTL_ADD, ringFd, &event) == 0)
+		m_RingFd = ringFd;
+}
+
+bool Reactor::Watch(int32 fd, bool write, IoRequest* request)
+{
+	if (fd < 0)
+		return false;
+	if ((SIZET)fd >= m_Sockets.size())
+		m_Sockets.resize((SIZET)fd + 1);
+
+	// Modifying a registered socket checks its readiness again, and finds out when a closed
+	// descriptor's number came back as another socket
+	Waiters& waiters = m_Sockets[fd];
+	epoll_event event = {};
+	event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	event.data.fd = fd;
+	int32 result = epoll_ctl(m_Fd, waiters.m_Registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event);
+	if (result < 0 && (errno == ENOENT || errno == EEXIST))
+		result = epoll_ctl(m_Fd, errno == ENOENT ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event);
+	if (result < 0)
+		return false;
+
+	waiters.m_Registered = true;
+	IoRequest*& list = write ? waiters.m_Writers : waiters.m_Readers;
+	request->m_Next = list;
+	list = request;
+	++m_Waiting;
+	return true;
+}
+
+void Reactor::Forget(int32 fd)
+{
+	if (fd < 0 || (SIZET)fd >= m_Sockets.size())
+		return;
+	Waiters& waiters = m_Sockets[fd];
+	Resume(waiters.m_Readers);
+	Resume(waiters.m_Writers);
+	waiters.m_Registered = false;
+}
+
+IoRequest* Reactor::Poll(bool check)
+{
+	if (m_Waiting && (check || ++m_Tick >= POLL_INTERVAL))
+	{
+		m_Tick = 0;
+		Check(0, 0);
+	}
+	IoRequest* ready = m_Ready;
+	m_Ready = nullptr;
+	m_ReadyTail = nullptr;
+	return ready;
+}
+
+void Reactor::Wait(uint64 timeUS)
+{
+	Check(-1, timeUS);
+}
+
+void Reactor::Interrupt()
+{
+	uint64 one = 1;
+	ssize_t bytes = write(m_WakeFd, &one, sizeof(one));
+	(void)bytes;
+}
+
+void Reactor::Check(int32 timeoutMS, uint64 timeUS)
+{
+	epoll_event events[EVENT_COUNT];
+	int32 count = 0;
+	if (timeoutMS < 0 && timeUS > 0)
+	{
+		// Microsecond timeouts where the kernel has epoll_pwait2, rounded up to milliseconds elsewhere
+		static std::atomic<bool> s_NoPwait2(false);
+#if defined(__NR_epoll_pwait2)
+		if (!s_NoPwait2.load(std::memory_order_relaxed))
+		{
+			__kernel_timespec timeout = { (int64)(timeUS / 1000000), (int64)(timeUS % 1000000) * 1000 };
+			count = (int32)syscall(__NR_epoll_pwait2, m_Fd, events, EVENT_COUNT, &timeout, nullptr, 0);
+			if (count >= 0 || errno != ENOSYS)
+				timeUS = 0;
+			else
+				s_NoPwait2.store(true, std::memory_order_relaxed);
+		}
+#else
+		s_NoPwait2.store(true, std::memory_order_relaxed);
+#endif
+		if (timeUS > 0)
+			count = epoll_wait(m_Fd, events, EVENT_COUNT, (int32)(TMIN((timeUS + 999) / 1000, (uint64)INT32_MAX)));
+	}
+	else
+	{
+		count = epoll_wait(m_Fd, events, EVENT_COUNT, timeoutMS);
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 fd = events[i].data.fd;
+		uint32 flags = events[i].events;
+		if (fd == m_WakeFd)
+		{
+			uint64 value = 0;
+			ssize_t bytes = read(m_WakeFd, &value, sizeof(value));
+			(void)bytes;
+			continue;
+		}
+		if (fd == m_RingFd || (SIZET)fd >= m_Sockets.size())
+			continue;
+
+		// Errors and hangups wake both sides, so each sees them from its own call
+		Waiters& waiters = m_Sockets[fd];
+		if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+			Resume(waiters.m_Readers);
+		if (flags & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+			Resume(waiters.m_Writers);
+	}
+}
+
+void Reactor::Resume(IoRequest*& list)
+{
+	IoRequest* request = list;
+	list = nullptr;
+	while (request)
+	{
+		IoRequest* next = request->m_Next;
+		request->m_Next = nullptr;
+		if (m_ReadyTail)
+			m_ReadyTail->m_Next = request;
+		else
+			m_Ready = request;
+		m_ReadyTail = request;
+		--m_Waiting;
+		request = next;
+	}
+}
+
+
+// Fiber side
+//------------------------------------------------------------------------------
+static bool IsFiberWorker(FiberWorker* worker)
+{
+	return worker && worker->m_Scheduler && worker->m_CurrentFiber;
+}
+
+// False when the caller has to do the blocking syscall
+static bool SubmitAndWait(uint8 opcode, int32 fd, const void* addr, uint32 len, uint64 offset, uint32 flags, int32& result)
+{
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	IoRing* ring = IsFiberWorker(worker) ? worker->GetIoRing() : nullptr;
+	if (!ring || !ring->IsValid())
+		return false;
+
+	IoRequest request;
+	request.m_Fiber = worker->m_CurrentFiber;
+	while (!ring->Queue(&request, opcode, fd, addr, len, offset, flags))
+	{
+		// The ring is full, let the worker reap some completions first
+		worker->m_Scheduler->YieldPoll(TimerUS(50));
+		worker = FiberWorker::GetCurrentThreadWorker();
+	}
+	// Resumed by the worker loop once the completion is reaped
+	worker->m_Scheduler->SuspendFiber();
+	result = request.m_Result;
+	return true;
+}
+
+static void WaitReady(int32 fd, bool write)
+{
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	Reactor* reactor = IsFiberWorker(worker) ? worker->GetReactor() : nullptr;
+	IoRequest request;
+	if (reactor && reactor->IsValid())
+	{
+		request.m_Fiber = worker->m_CurrentFiber;
+		if (reactor->Watch(fd, write, &request))
+		{
+			worker->m_Scheduler->SuspendFiber();
+			return;
+		}
+	}
+
+	pollfd descriptor = {};
+	descriptor.fd = fd;
+	descriptor.events = write ? POLLOUT : POLLIN;
+	poll(&descriptor, 1, -1);
+}
+
+static int32 Blocking(int32 result)
+{
+	return result < 0 ? -errno : result;
+}
+
+// Runs a non-blocking socket call until it gets through, waiting for the socket each time it would block
+template<class Call>
+static int32 Retry(int32 fd, bool write, Call&& call)
+{
+	for (;;)
+	{
+		int32 result = Blocking(call());
+		if (result == -EAGAIN || result == -EWOULDBLOCK)
+			WaitReady(fd, write);
+		else if (result != -EINTR)
+			return result;
+	}
+}
+
+namespace FiberIO
+{
+	int32 OpenAt(int32 dirFd, const char* path, int32 flags, uint32 mode)
+	{
+		int32 result = 0;
+		return SubmitAndWait(IORING_OP_OPENAT, dirFd, path, mode, 0, (uint32)flags, result) ? result : Blocking(openat(dirFd, path, flags, mode));
+	}
+
+	int32 Read(int32 fd, void* buffer, uint32 size, uint64 offset)
+	{
+		int32 result = 0;
+		return SubmitAndWait(IORING_OP_READ, fd, buffer, size, offset, 0, result) ? result : Blocking((int32)pread(fd, buffer, size, (off_t)offset));
+	}
+
+	int32 Write(int32 fd, const void* buffer, uint32 size, uint64 offset)
+	{
+		int32 result = 0;
+		return SubmitAndWait(IORING_OP_WRITE, fd, buffer, size, offset, 0, result) ? result : Blocking((int32)pwrite(fd, buffer, size, (off_t)offset));
+	}
+
+	int32 Fsync(int32 fd, bool dataOnly)
+	{
+		int32 result = 0;
+		return SubmitAndWait(IORING_OP_FSYNC, fd, nullptr, 0, 0, dataOnly ? IORING_FSYNC_DATASYNC : 0, result) ? result : Blocking(dataOnly ? fdatasync(fd) : fsync(fd));
+	}
+
+	int32 Close(int32 fd)
+	{
+		FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+		if (Reactor* reactor = IsFiberWorker(worker) ? worker->GetReactor(false) : nullptr)
+			reactor->Forget(fd);
+		int32 result = 0;
+		return SubmitAndWait(IORING_OP_CLOSE, fd, nullptr, 0, 0, 0, result) ? result : Blocking(close(fd));
+	}
+
+	int32 Socket(int32 domain, int32 type, int32 protocol)
+	{
+		return Blocking(socket(domain, type | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol));
+	}
+
+	int32 Accept(int32 fd, sockaddr* addr, uint32* addrLen)
+	{
+		return Retry(fd, false, [=]() { return accept4(fd, addr, (socklen_t*)addrLen, SOCK_NONBLOCK | SOCK_CLOEXEC); });
+	}
+
+	int32 Connect(int32 fd, const sockaddr* addr, uint32 addrLen)
+	{
+		int32 result = Blocking(connect(fd, addr, (socklen_t)addrLen));
+		if (result != -EINPROGRESS && result != -EINTR)
+			return result;
+
+		// The connection goes on in the background, the socket turns writable once it is through
+		int32 error = EINPROGRESS;
+		while (error == EINPROGRESS || error == EALREADY)
+		{
+			WaitReady(fd, true);
+			socklen_t length = sizeof(error);
+			if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0)
+				return -errno;
+			if (error == 0)
+			{
+				// SO_ERROR is also 0 while still connecting, a peer name only exists once connected
+				sockaddr_storage peer;
+				socklen_t peerLength = sizeof(peer);
+				if (getpeername(fd, (sockaddr*)&peer, &peerLength) < 0 && errno == ENOTCONN)
+					error = EINPROGRESS;
+			}
+		}
+		return -error;
+	}
+
+	int32 Recv(int32 fd, void* buffer, uint32 size, int32 flags)
+	{
+		if (!(flags & MSG_WAITALL))
+			return Retry(fd, false, [=]() { return (int32)recv(fd, buffer, size, flags | MSG_DONTWAIT); });
+
+		// A non-blocking recv ignores MSG_WAITALL, so the pieces are gathered here
+		uint32 received = 0;
+		flags = (flags & ~MSG_WAITALL) | MSG_DONTWAIT;
+		while (received < size)
+		{
+			uint8* dest = (uint8*)buffer + received;
+			int32 result = Retry(fd, false, [=]() { return (int32)recv(fd, dest, size - received, flags); });
+			if (result <= 0)
+				return received ? (int32)received : result;
+			received += (uint32)result;
+		}
+		return (int32)received;
+	}
+
+	int32 Send(int32 fd, const void* buffer, uint32 size, int32 flags)
+	{
+		return Retry(fd, true, [=]() { return (int32)send(fd, buffer, size, flags | MSG_DONTWAIT | MSG_NOSIGNAL); });
+	}
+}
+
+#else
+
+IoRing::IoRing()
+	: m_Fd(-1)
+	, m_InFlight(0)
+{
+}
+
+IoRing::~IoRing()
+{
+}
+
+bool IoRing::Init(uint32 entries)
+{
+	return false;
+}
+
+bool IoRing::Queue(IoRequest* request, uint8 opcode, int32 fd, const void* addr, uint32 len, uint64 offset, uint32 flags)
+{
+	return false;
+}
+
+void IoRing::Submit(bool flush)
+{
+}
+
+IoRequest* IoRing::Reap()
+{
+	return nullptr;
+}
+
+bool IoRing::HasCompletions() const
+{
+	return false;
+}
+
+Reactor::Reactor()
+	: m_Fd(-1)
+	, m_WakeFd(-1)
+	, m_RingFd(-1)
+	, m_Waiting(0)
+	, m_Tick(0)
+	, m_Ready(nullptr)
+	, m_ReadyTail(nullptr)
+{
+}
+
+Reactor::~Reactor()
+{
+}
+
+bool Reactor::Init()
+{
+	return false;
+}
+
+void Reactor::WatchRing(int32 ringFd)
+{
+}
+
+bool Reactor::Watch(int32 fd, bool write, IoRequest* request)
+{
+	return false;
+}
+
+void Reactor::Forget(int32 fd)
+{
+}
+
+IoRequest* Reactor::Poll(bool check)
+{
+	return nullptr;
+}
+
+void Reactor::Wait(uint64 timeUS)
+{
+}
+
+void Reactor::Interrupt()
+{
+}
+
+// Without io_uring and epoll the calls block the worker like the syscalls
+namespace FiberIO
+{
+#if defined(__WINDOWS__)
+	int32 OpenAt(int32 dirFd, const char* path, int32 flags, uint32 mode) { return -ENOSYS; }
+	int32 Read(int32 fd, void* buffer, uint32 size, uint64 offset) { return -ENOSYS; }
+	int32 Write(int32 fd, const void* buffer, uint32 size, uint64 offset) { return -ENOSYS; }
+	int32 Fsync(int32 fd, bool dataOnly) { return -ENOSYS; }
+	int32 Close(int32 fd) { return -ENOSYS; }
+	int32 Socket(int32 domain, int32 type, int32 protocol) { return -ENOSYS; }
+	int32 Accept(int32 fd, sockaddr* addr, uint32* addrLen) { return -ENOSYS; }
+	int32 Connect(int32 fd, const sockaddr* addr, uint32 addrLen) { return -ENOSYS; }
+	int32 Recv(int32 fd, void* buffer, uint32 size, int32 flags) { return -ENOSYS; }
+	int32 Send(int32 fd, const void* buffer, uint32 size, int32 flags) { return -ENOSYS; }
+#else
+	static int32 Blocking(int32 result) { return result < 0 ? -errno : result; }
+
+	int32 OpenAt(int32 dirFd, const char* path, int32 flags, uint32 mode) { return Blocking(openat(dirFd, path, flags, mode)); }
+	int32 Read(int32 fd, void* buffer, uint32 size, uint64 offset) { return Blocking((int32)pread(fd, buffer, size, (off_t)offset)); }
+	int32 Write(int32 fd, const void* buffer, uint32 size, uint64 offset) { return Blocking((int32)pwrite(fd, buffer, size, (off_t)offset)); }
+	int32 Fsync(int32 fd, bool dataOnly) { return Blocking(fsync(fd)); }
+	int32 Close(int32 fd) { return Blocking(close(fd)); }
+	int32 Socket(int32 domain, int32 type, int32 protocol) { return Blocking(socket(domain, type, protocol)); }
+	int32 Accept(int32 fd, sockaddr* addr, uint32* addrLen) { return Blocking(accept(fd, addr, (socklen_t*)addrLen)); }
+	int32 Connect(int32 fd, const sockaddr* addr, uint32 addrLen) { return Blocking(connect(fd, addr, (socklen_t)addrLen)); }
+	int32 Recv(int32 fd, void* buffer, uint32 size, int32 flags) { return Blocking((int32)recv(fd, buffer, size, flags)); }
+	int32 Send(int32 fd, const void* buffer, uint32 size, int32 flags) { return Blocking((int32)send(fd, buffer, size, flags)); }
+#endif
+}
+
+#endif
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -6,38 +6,69 @@
 #include "Fiber/FiberWorker.h"
 #include "Fiber/FiberJob.h"
 #include "Fiber/FiberScheduler.h"
+#include "Fiber/FiberTrace.h"
+#include "Fiber/JobPool.h"
 #include "Misc.h"
-#include <mutex>
+#include <thread>
 
 
 FiberJob::FiberJob()
-	: m_JobSignal(nullptr)
-	, m_Scheduler(nullptr)
+	: m_Job(nullptr)
+	, m_Record(nullptr)
 	, m_WorkerID(0)
-	, m_HoldTime(0)
+	, m_WorkerFilter(0)
+	, m_Scheduler(nullptr)
+	, m_ReadyNS(0)
+	, m_ReadyUS(0)
+	, m_DeadlineUS(0)
+	, m_PeriodUS(0)
 {
 }
 
-FiberJob::FiberJob(FiberScheduler* sche)
-	: m_JobSignal(nullptr)
-	, m_Scheduler(sche)
-	, m_WorkerID(0)
-	, m_HoldTime(0)
+FiberJob::~FiberJob()
 {
+	Reset();
 }
 
-FiberJob::FiberJob(FiberScheduler* sche, std::shared_ptr<Job> job)
-	: m_Job(job)
-	, m_Scheduler(sche)
-	, m_JobSignal(sche->FetchSignal())
-	, m_WorkerID()
-	, m_HoldTime(0)
+JobSignalPtr FiberJob::GetSignal() const
 {
-	m_JobSignal->m_RefCount ++;
+	return JobSignalPtr(m_Record);
 }
 
-FiberJob::~FiberJob()
+JobSignal* FiberJob::GetJobSignal() const
+{
+	return &m_Record->m_Signal;
+}
+
+void FiberJob::SetJob(std::shared_ptr<Job> job)
 {
+	m_Job = job.get();
+	m_SharedJob = std::move(job);
+}
+
+void FiberJob::Reset()
+{
+	if (m_Job == reinterpret_cast<Job*>(m_InlineJob))
+		m_Job->~Job();
+	m_Job = nullptr;
+	m_SharedJob = nullptr;
+	m_WorkerID = 0;
+	m_WorkerFilter = 0;
+	m_Scheduler = nullptr;
+	m_ReadyNS = 0;
+	m_ReadyUS = 0;
+	m_DeadlineUS = 0;
+	m_PeriodUS = 0;
+	m_TimerNode = TimerNode();
+}
+
+void FiberJob::StartCounter()
+{
+	// A deadline given at post time is kept when the job has no period of its own
+	m_ReadyNS = TimerWheel::NowNS();
+	m_ReadyUS = m_ReadyNS / 1000;
+	if (m_Job->GetMaxPeriod())
+		SetMaxPeriod(m_Job->GetMaxPeriod());
 }
 
 int32 FiberJob::Execute()
@@ -53,75 +84,171 @@ int32 FiberJob::Execute()
 
 FiberJobPtr FiberJob::PostSuccessor(std::shared_ptr<Job> job, uint64 worker)
 {
-	return m_Scheduler->PostJob(job, m_JobSignal, worker);
+	return m_Scheduler->PostJob(job, GetSignal(), worker);
 }
 
 FiberJobPtr FiberJob::PostCompletor(std::shared_ptr<Job> job)
 {
-	return m_Scheduler->PostJob(job, m_JobSignal, ThreadWorker::GetCurrentThreadFilter());
+	return m_Scheduler->PostJob(job, GetSignal(), ThreadWorker::GetCurrentThreadFilter());
 }
 
 
+// Successor list states besides an open list, they never point to a node
+static JobSignalNode* const CLOSED_LIST = reinterpret_cast<JobSignalNode*>(1);
+static JobSignalNode* const DISPATCHING_LIST = reinterpret_cast<JobSignalNode*>(2);
+
 JobSignal::JobSignal()
 	: m_Scheduler(nullptr)
+	, m_Record(nullptr)
 	, m_RefCount(0)
-{
-}
-
-JobSignal::JobSignal(FiberScheduler* scheduler)
-	: m_Scheduler(scheduler)
-	, m_RefCount(0)
+	, m_Result(0)
+	, m_Successors(CLOSED_LIST)
 {
 }
 
 void JobSignal::Trigger(int32 result)
 {
-	std::lock_guard<std::mutex> lock(m_Mutex);
-	ASSERT(IsValid());
-
-	if (--m_RefCount > 0)
-	{
+	int32 count = m_RefCount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	ASSERT(count >= 0);
+	if (count > 0)
 		return;
-	}
 
-	for (auto& job : m_NextJobs)
+	m_Result.store(result, std::memory_order_relaxed);
+	FIBER_TRACE(SIGNAL_TRIGGER, (uint64)m_Record->m_Generation << 32 | m_Record->m_Index, nullptr, (uint32)result);
+	JobSignalNode* node = m_Successors.exchange(DISPATCHING_LIST, std::memory_order_acq_rel);
+	ASSERT(node != CLOSED_LIST && node != DISPATCHING_LIST);
+
+	// The list is pushed at the head, run the successors in the order they were added
+	JobSignalNode* ordered = nullptr;
+	while (node)
 	{
-		job->SetPreResult(result);
-		m_Scheduler->PushJob(job);
+		JobSignalNode* next = node->m_Next;
+		node->m_Next = ordered;
+		ordered = node;
+		node = next;
 	}
-	for (auto& trigger : m_Triggers)
+	while (ordered)
 	{
-		trigger->Trigger(result);
+		// A pushed job may run and recycle its node before the loop moves on
+		JobSignalNode* next = ordered->m_Next;
+		if (FiberJob* job = ordered->m_Job)
+		{
+			job->SetPreResult(result);
+			m_Scheduler->PushJob(job);
+		}
+		else
+		{
+			JobSignal* trigger = ordered->m_Trigger;
+			ReleaseNode(ordered);
+			trigger->Trigger(result);
+		}
+		ordered = next;
 	}
-	m_NextJobs.clear();
-	m_Triggers.clear();
-	ASSERT(m_RefCount == 0);
+	m_Successors.store(CLOSED_LIST, std::memory_order_release);
+
+	// Drop the hold taken when the signal was armed, this may recycle the record
+	m_Record->ReleaseHold();
 }
 
-bool JobSignal::IsValid()
+bool JobSignal::IsValid() const
 {
-	return m_RefCount > 0;
+	return m_RefCount.load(std::memory_order_acquire) > 0;
+}
+
+void JobSignal::Arm(int32 count)
+{
+	if (m_RefCount.fetch_add(count, std::memory_order_acq_rel) != 0)
+		return;
+
+	m_Record->AddHold();
+	// Reopen the list once the trigger that last reached zero is done with it. Successors
+	// added meanwhile are still run by that trigger, as they would be on a fired signal.
+	JobSignalNode* closed = CLOSED_LIST;
+	while (!m_Successors.compare_exchange_weak(closed, nullptr, std::memory_order_acquire, std::memory_order_relaxed))
+	{
+		if (closed != CLOSED_LIST)
+			std::this_thread::yield();
+		closed = CLOSED_LIST;
+	}
 }
 
-void JobSignal::AddTrigger(JobSignalPtr signal, bool inc)
+void JobSignal::AddTrigger(JobSignal* signal, bool inc)
 {
-	std::lock_guard<std::mutex> lock(m_Mutex);
 	if (!IsValid())
 		return;
 
+	// An armed signal holds its record, so the list never points to a recycled one
 	if (inc)
-		signal->m_RefCount ++;
-	
-	ASSERT(std::find(m_Triggers.begin(), m_Triggers.end(), signal) == m_Triggers.end());
-	m_Triggers.push_back(signal);
+		signal->Arm();
+	ASSERT(signal->IsValid());
+
+	JobSignalNode* node = AcquireNode();
+	node->m_Trigger = signal;
+	if (!PushNode(node))
+	{
+		// Fired in the meantime, pass its result on as it would have
+		ReleaseNode(node);
+		if (inc)
+			signal->Trigger(m_Result.load(std::memory_order_relaxed));
+	}
 }
 
-void JobSignal::PushJob(FiberJobPtr job, bool lock)
+bool JobSignal::PushJob(FiberJob* job)
 {
-	if (lock) m_Mutex.lock();
-	ASSERT(IsValid());
-	m_NextJobs.push_back(job);
-	if (lock) m_Mutex.unlock();
+	job->m_SignalNode.m_Job = job;
+	return PushNode(&job->m_SignalNode);
 }
 
-//------------------------------------------------------------------------------
\ No newline at end of file
+bool JobSignal::PushNode(JobSignalNode* node)
+{
+	JobSignalNode* head = m_Successors.load(std::memory_order_acquire);
+	do
+	{
+		if (head == CLOSED_LIST || head == DISPATCHING_LIST)
+			return false;
+		node->m_Next = head;
+	} while (!m_Successors.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_acquire));
+	return true;
+}
+
+JobSignalNode* JobSignal::AcquireNode()
+{
+	for (auto& node : m_InlineNodes)
+	{
+		bool used = false;
+		if (!node.m_Used.load(std::memory_order_relaxed) && node.m_Used.compare_exchange_strong(used, true, std::memory_order_acquire))
+			return &node;
+	}
+	return new JobSignalNode();
+}
+
+void JobSignal::ReleaseNode(JobSignalNode* node)
+{
+	if (node >= m_InlineNodes && node < m_InlineNodes + INLINE_NODES)
+	{
+		node->m_Next = nullptr;
+		node->m_Trigger = nullptr;
+		node->m_Used.store(false, std::memory_order_release);
+	}
+	else
+	{
+		delete node;
+	}
+}
+
+void JobSignal::Reset()
+{
+	m_Scheduler = nullptr;
+	m_RefCount = 0;
+	m_Result = 0;
+	m_Successors = CLOSED_LIST;
+}
+
+
+void JobRecord::ReleaseHold()
+{
+	if (m_Holds.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		m_Pool->Free(this);
+}
+
+//------------------------------------------------------------------------------
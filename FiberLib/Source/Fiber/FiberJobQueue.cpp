@@ -0,0 +1,266 @@
+// FiberJobQueue.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/FiberJobQueue.h"
+#include "Fiber/FiberJob.h"
+#include <algorithm>
+
+
+FiberJobQueue::FiberJobQueue()
+	: m_UsedSlots(0)
+	, m_OccupiedSlots(0)
+	, m_OccupiedPrios(0)
+	, m_OverflowWorkers(0)
+{
+	std::fill(std::begin(m_SlotJobCount), std::end(m_SlotJobCount), 0);
+	std::fill(std::begin(m_OverflowJobs), std::end(m_OverflowJobs), 0);
+	std::fill(std::begin(m_SlotFilters), std::end(m_SlotFilters), 0);
+	for (auto& slots : m_WorkerSlots)
+		slots = 0;
+	for (auto& slots : m_PrioSlots)
+		slots = 0;
+}
+
+void FiberJobQueue::Push(FiberJob* job)
+{
+	int32 slot = AcquireSlot(job->GetWorkerFilter());
+	if (slot < 0)
+	{
+		m_Overflow.push_back(job);
+		AddOverflow(job->GetWorkerFilter());
+		return;
+	}
+
+	uint32 prio = job->GetJob()->GetPriority();
+	uint64 slotBit = (uint64)1 << slot;
+	m_Jobs[prio][slot].push_back(job);
+	m_SlotJobCount[slot]++;
+
+	m_PrioSlots[prio].fetch_or(slotBit, std::memory_order_relaxed);
+	m_OccupiedPrios.fetch_or(1u << prio, std::memory_order_relaxed);
+	m_OccupiedSlots.fetch_or(slotBit, std::memory_order_release);
+}
+
+FiberJob* FiberJobQueue::Pop(uint64 workerFilter)
+{
+	uint64 eligible = GetEligibleSlots(workerFilter);
+	uint32 prios = m_OccupiedPrios.load(std::memory_order_relaxed);
+	while (prios)
+	{
+		uint32 prio = (uint32)CountTrailingZeros64(prios);
+		prios &= prios - 1;
+
+		uint64 slots = m_PrioSlots[prio].load(std::memory_order_relaxed) & eligible;
+		if (!slots)
+			continue;
+
+		uint32 slot = (uint32)CountTrailingZeros64(slots);
+		uint64 slotBit = (uint64)1 << slot;
+		auto& jobs = m_Jobs[prio][slot];
+		FiberJob* job = jobs.back();
+		jobs.pop_back();
+
+		if (jobs.empty())
+		{
+			if (m_PrioSlots[prio].fetch_and(~slotBit, std::memory_order_relaxed) == slotBit)
+				m_OccupiedPrios.fetch_and(~(1u << prio), std::memory_order_relaxed);
+		}
+		if (--m_SlotJobCount[slot] == 0)
+			ReleaseSlot(slot);
+		return job;
+	}
+
+	if (m_OverflowWorkers.load(std::memory_order_relaxed) & workerFilter)
+	{
+		auto it = std::find_if(m_Overflow.rbegin(), m_Overflow.rend(), [workerFilter](FiberJob* job) {
+			return (job->GetWorkerFilter() & workerFilter) != 0;
+		});
+		if (it != m_Overflow.rend())
+		{
+			FiberJob* job = *it;
+			m_Overflow.erase(std::next(it).base());
+			RemoveOverflow(job->GetWorkerFilter());
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void FiberJobQueue::Clear()
+{
+	for (auto& prioJobs : m_Jobs)
+	{
+		for (auto& jobs : prioJobs)
+			jobs.clear();
+	}
+	std::fill(std::begin(m_SlotJobCount), std::end(m_SlotJobCount), 0);
+	for (auto& slots : m_PrioSlots)
+		slots = 0;
+	m_OccupiedSlots = 0;
+	m_OccupiedPrios = 0;
+	m_Overflow.clear();
+	std::fill(std::begin(m_OverflowJobs), std::end(m_OverflowJobs), 0);
+	m_OverflowWorkers = 0;
+}
+
+uint64 FiberJobQueue::GetEligibleSlots(uint64 workerFilter) const
+{
+	if ((workerFilter & (workerFilter - 1)) == 0)
+		return workerFilter ? m_WorkerSlots[CountTrailingZeros64(workerFilter)].load(std::memory_order_relaxed) : 0;
+
+	uint64 slots = 0;
+	for (uint64 bits = workerFilter; bits; bits &= bits - 1)
+		slots |= m_WorkerSlots[CountTrailingZeros64(bits)].load(std::memory_order_relaxed);
+	return slots;
+}
+
+int32 FiberJobQueue::AcquireSlot(uint64 workerFilter)
+{
+	auto it = m_FilterSlots.find(workerFilter);
+	if (it != m_FilterSlots.end())
+		return (int32)it->second;
+
+	if (m_UsedSlots == ~(uint64)0)
+	{
+		// Every slot is registered, take one back from a filter that has run empty
+		uint64 empty = ~m_OccupiedSlots.load(std::memory_order_relaxed);
+		if (!empty)
+			return -1;
+		FreeSlot((uint32)CountTrailingZeros64(empty));
+	}
+
+	uint32 slot = (uint32)CountTrailingZeros64(~m_UsedSlots);
+	uint64 slotBit = (uint64)1 << slot;
+	m_UsedSlots |= slotBit;
+	m_SlotFilters[slot] = workerFilter;
+	m_FilterSlots.emplace(workerFilter, slot);
+	for (uint64 bits = workerFilter; bits; bits &= bits - 1)
+		m_WorkerSlots[CountTrailingZeros64(bits)].fetch_or(slotBit, std::memory_order_relaxed);
+	return (int32)slot;
+}
+
+void FiberJobQueue::ReleaseSlot(uint32 slot)
+{
+	// Keep the filter registered, AcquireSlot takes the slot back once a new filter needs it
+	m_OccupiedSlots.fetch_and(~((uint64)1 << slot), std::memory_order_release);
+}
+
+void FiberJobQueue::FreeSlot(uint32 slot)
+{
+	ASSERT(m_SlotJobCount[slot] == 0);
+	uint64 slotBit = (uint64)1 << slot;
+	for (uint64 bits = m_SlotFilters[slot]; bits; bits &= bits - 1)
+		m_WorkerSlots[CountTrailingZeros64(bits)].fetch_and(~slotBit, std::memory_order_relaxed);
+	m_FilterSlots.erase(m_SlotFilters[slot]);
+	m_SlotFilters[slot] = 0;
+	m_UsedSlots &= ~slotBit;
+}
+
+void FiberJobQueue::AddOverflow(uint64 workerFilter)
+{
+	// Per worker, so only the workers that may run an overflow job see it and stay awake for it
+	uint64 eligible = 0;
+	for (uint64 bits = workerFilter; bits; bits &= bits - 1)
+	{
+		uint32 worker = (uint32)CountTrailingZeros64(bits);
+		if (m_OverflowJobs[worker]++ == 0)
+			eligible |= (uint64)1 << worker;
+	}
+	m_OverflowWorkers.fetch_or(eligible, std::memory_order_release);
+}
+
+void FiberJobQueue::RemoveOverflow(uint64 workerFilter)
+{
+	uint64 drained = 0;
+	for (uint64 bits = workerFilter; bits; bits &= bits - 1)
+	{
+		uint32 worker = (uint32)CountTrailingZeros64(bits);
+		if (--m_OverflowJobs[worker] == 0)
+			drained |= (uint64)1 << worker;
+	}
+	m_OverflowWorkers.fetch_and(~drained, std::memory_order_relaxed);
+}
+
+
+static bool LaterDeadline(FiberJob* a, FiberJob* b)
+{
+	return a->GetDeadline() > b->GetDeadline();
+}
+
+DeadlineJobQueue::DeadlineJobQueue()
+	: m_WorkerMask(~(uint64)0)
+	, m_EligibleWorkers(0)
+{
+	std::fill(std::begin(m_WorkerJobs), std::end(m_WorkerJobs), 0);
+}
+
+void DeadlineJobQueue::Push(FiberJob* job)
+{
+	m_Heap.push_back(job);
+	std::push_heap(m_Heap.begin(), m_Heap.end(), LaterDeadline);
+
+	uint64 eligible = 0;
+	for (uint64 bits = job->GetWorkerFilter() & m_WorkerMask; bits; bits &= bits - 1)
+	{
+		uint32 worker = (uint32)CountTrailingZeros64(bits);
+		if (m_WorkerJobs[worker]++ == 0)
+			eligible |= (uint64)1 << worker;
+	}
+	m_EligibleWorkers.fetch_or(eligible, std::memory_order_release);
+}
+
+FiberJob* DeadlineJobQueue::Pop(uint64 workerFilter, uint64 nowUS)
+{
+	if (m_Heap.empty())
+		return nullptr;
+
+	// Expired jobs are only dropped, any worker may take them
+	if (m_Heap.front()->GetDeadline() <= nowUS || (m_Heap.front()->GetWorkerFilter() & workerFilter))
+		return Remove(0);
+
+	// The earliest job is for other workers, look for the earliest one we may run
+	SIZET best = m_Heap.size();
+	for (SIZET i = 1; i < m_Heap.size(); ++i)
+	{
+		if ((m_Heap[i]->GetWorkerFilter() & workerFilter) && (best == m_Heap.size() || m_Heap[i]->GetDeadline() < m_Heap[best]->GetDeadline()))
+			best = i;
+	}
+	return best < m_Heap.size() ? Remove(best) : nullptr;
+}
+
+void DeadlineJobQueue::Clear()
+{
+	m_Heap.clear();
+	std::fill(std::begin(m_WorkerJobs), std::end(m_WorkerJobs), 0);
+	m_EligibleWorkers = 0;
+}
+
+FiberJob* DeadlineJobQueue::Remove(SIZET index)
+{
+	FiberJob* job = m_Heap[index];
+	if (index == 0)
+	{
+		std::pop_heap(m_Heap.begin(), m_Heap.end(), LaterDeadline);
+		m_Heap.pop_back();
+	}
+	else
+	{
+		m_Heap[index] = m_Heap.back();
+		m_Heap.pop_back();
+		std::make_heap(m_Heap.begin(), m_Heap.end(), LaterDeadline);
+	}
+
+	uint64 drained = 0;
+	for (uint64 bits = job->GetWorkerFilter() & m_WorkerMask; bits; bits &= bits - 1)
+	{
+		uint32 worker = (uint32)CountTrailingZeros64(bits);
+		if (--m_WorkerJobs[worker] == 0)
+			drained |= (uint64)1 << worker;
+	}
+	m_EligibleWorkers.fetch_and(~drained, std::memory_order_relaxed);
+	return job;
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
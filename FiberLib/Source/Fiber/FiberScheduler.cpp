@@ -6,9 +6,13 @@
 #include "Fiber/FiberScheduler.h"
 #include "Fiber/Fiber.h"
 #include "Fiber/FiberJob.h"
+#include "Fiber/FiberTrace.h"
 #include "Fiber/FiberWorker.h"
+#include "Fiber/JobEpoch.h"
 #include <string>
 #include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
 
 
 /*static*/ void FiberScheduler::Poll(void* data)
@@ -18,20 +22,29 @@
 
 	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
 	ASSERT(worker->GetThreadID() == FiberWorker::GetCurrentThreadID());
+	sche->FreeDeferredFiber();
 	while (!worker->IsStopped()) 
 	{
 		FiberDesc* fiber = nullptr;
-		FiberJobPtr job;
+		FiberJob* job = nullptr;
 		while (!worker->IsStopped())
 		{
-			std::unique_lock<std::mutex> lock(sche->m_JobLock);
-			int32 remainMS = 0;
+			uint64 remainUS = ~(uint64)0;
+			{
+				job = worker->m_HandoffJob;
+				worker->m_HandoffJob = nullptr;
+				if (job) break;
+			}
 			{
 				job = sche->PopPendingJob(worker->GetThreadID());
-				if (job.get()) break;
+				if (job) break;
+			}
+			{
+				fiber = sche->PopTimerFiber(worker, remainUS);
+				if (fiber) break;
 			}
 			{
-				fiber = sche->PopLoopFiber(worker->GetThreadID(), remainMS);
+				fiber = sche->PopIoFiber(worker, false);
 				if (fiber) break;
 			}
 			{
@@ -40,47 +53,83 @@
 			}
 			{
 				job = sche->PopJob(worker->GetThreadFilterID());
-				if (job.get()) break;
+				if (job) break;
+			}
+			{
+				// Nothing else to run, hand the queued I/O to the kernel and check the sockets before going idle
+				fiber = sche->PopIoFiber(worker, true);
+				if (fiber) break;
 			}
-			ASSERT(remainMS >= 0);
-			worker->Sleep(lock, (uint32)remainMS);
+			// Park until woken when no timer is set, never without a timeout when one is due
+			uint64 parkUS = remainUS == ~(uint64)0 ? 0 : (TMAX(remainUS, (uint64)1));
+			worker->Idle(sche->m_IdlePolicy.load(std::memory_order_relaxed), parkUS);
 		}
+		worker->ResetIdle();
 		if (worker->IsStopped())
 			break;
 
-		if (fiber) 
+		if (!fiber)
 		{
-			worker->m_CurrentFiber = fiber;
-			ASSERT(!self->m_CurrentJob.get());
-			sche->FreeFiber(self);
-			Fiber::SwitchTo(fiber->m_Fiber);
-			worker = FiberWorker::GetCurrentThreadWorker();
-			worker->m_CurrentFiber = self;			
+			// Hand the job over when it needs a larger stack than this fiber has, or asked for
+			// a smaller one than polling fibers get
+			uint8 stackSize = sche->GetStackSize(job->GetJob());
+			if (stackSize > self->m_StackSize || (stackSize < self->m_StackSize && stackSize < sche->m_DefaultStackSize))
+			{
+				worker->m_HandoffJob = job;
+				fiber = sche->FetchFiber(stackSize);
+			}
 		}
-		else 
+
+		if (!fiber)
 		{
 			self->m_CurrentJob = job;
 			int32 result = 0;
+			// A pending or handed over job may have expired since it was taken
 			if (job->IsTimeout())
 				job->SetStatus(Job::Status::STATUS_EXPIRED);
 			else
+			{
+				uint8 prio = job->GetJob()->GetPriority();
+				uint64 startNS = TimerWheel::NowNS();
+				worker->m_Metrics.AddQueueLatency(prio, startNS > job->GetReadyTime() ? startNS - job->GetReadyTime() : 0);
+				FIBER_TRACE(JOB_START, job->GetID(), job->GetJob()->GetName(), 0);
 				result = job->Execute();
+				FIBER_TRACE(JOB_END, job->GetID(), job->GetJob()->GetName(), (uint32)result);
+				// The fiber may have been resumed on another worker
+				worker = FiberWorker::GetCurrentThreadWorker();
+				worker->m_Metrics.AddJobExecuted();
+				worker->m_Metrics.AddRunTime(prio, TimerWheel::NowNS() - startNS);
+			}
 			self->m_CurrentJob = nullptr;
-			job->GetSignal()->Trigger(result);
 			worker = FiberWorker::GetCurrentThreadWorker();
+			sche->_FinishJob(job, result);
+
+			// Too small to poll for jobs, go back to the pool until the next small job is handed over
+			if (self->m_StackSize < sche->m_DefaultStackSize && !worker->IsStopped())
+				fiber = sche->FetchFiber();
+		}
+
+		if (fiber) 
+		{
+			FIBER_TRACE(FIBER_SWITCH, (UINTPTR)fiber, nullptr, 0);
+			worker->m_Metrics.AddContextSwitch();
+			worker->m_CurrentFiber = fiber;
+			ASSERT(!self->m_CurrentJob);
+			worker->m_DeferredFiber = self;
+			Fiber::SwitchTo(fiber->m_Fiber);
+			worker = FiberWorker::GetCurrentThreadWorker();
+			worker->m_CurrentFiber = self;
+			sche->FreeDeferredFiber();
 		}
 	}
-	sche->FreeFiber(self);
-	Fiber::SwitchTo(FiberWorker::GetCurrentThreadWorker()->m_MainFiber);
+	worker->m_DeferredFiber = self;
+	Fiber::SwitchTo(worker->m_MainFiber);
 }
 
 FiberScheduler::FiberScheduler()
-	: m_JobAllocator(new std::pmr::synchronized_pool_resource())
-	, m_FiberAllocator(new std::pmr::synchronized_pool_resource())
-	, m_SignalAllocator(new std::pmr::synchronized_pool_resource())
+	: m_FiberAllocator(&m_PoolResource)
 {
 	m_Workers.reserve(64);
-	m_LoopFibers.resize(64);
 	m_PendingJobs.resize(64);
 	m_ReadyFibers.resize(64);
 }
@@ -98,7 +147,47 @@ void FiberScheduler::InitWorker(uint8 count)
 		FiberWorker* worker = new FiberWorker(name.c_str(), (uint32)i);
 		worker->SetScheduler(this);
 		m_Workers.push_back(worker);
-		worker->Init();
+	}
+
+	// Every worker except main steals, so only jobs every thief may run go to the per worker queues
+	m_StealMask = 0;
+	std::for_each(m_Workers.begin(), m_Workers.end(), [this](auto& worker) { m_StealMask |= worker->GetThreadFilterID(); });
+	m_StealMask &= ~(uint64)ThreadWorkerFilter::E_WORKER_ON_MAIN;
+	m_WorkerMask = m_Workers.size() >= 64 ? ~(uint64)0 : ((uint64)1 << m_Workers.size()) - 1;
+	m_DeadlineJobs.SetWorkerMask(m_WorkerMask);
+
+	std::vector<std::vector<uint32>> placement = CpuTopology::Get().Place(m_AffinityPolicy, (uint32)m_Workers.size());
+	for (SIZET i = 0; i < m_Workers.size(); ++i)
+		m_Workers[i]->SetAffinity(placement[i]);
+	_InitStealOrder();
+
+	std::for_each(m_Workers.begin(), m_Workers.end(), [](auto& worker) { worker->Init(); });
+}
+
+void FiberScheduler::SetAffinityPolicy(AffinityPolicy policy)
+{
+	ASSERT(m_Workers.empty());
+	m_AffinityPolicy = policy;
+}
+
+void FiberScheduler::_InitStealOrder()
+{
+	// Each thief goes round from the worker after it, pinned ones try those sharing their core, L3 and node first
+	const CpuTopology& topology = CpuTopology::Get();
+	SIZET count = m_Workers.size();
+	for (FiberWorker* thief : m_Workers)
+	{
+		auto distance = [&topology, thief](FiberWorker* victim) {
+			if (thief->GetAffinity().empty() || victim->GetAffinity().empty())
+				return CpuTopology::REMOTE;
+			return topology.GetDistance(thief->GetAffinity().front(), victim->GetAffinity().front());
+		};
+		thief->m_Victims.clear();
+		for (SIZET i = 1; i < count; ++i)
+			thief->m_Victims.push_back(m_Workers[(thief->GetThreadID() + i) % count]);
+		std::stable_sort(thief->m_Victims.begin(), thief->m_Victims.end(), [&distance](FiberWorker* a, FiberWorker* b) {
+			return distance(a) < distance(b);
+		});
 	}
 }
 
@@ -107,102 +196,261 @@ void FiberScheduler::ShutDown()
 	std::for_each(m_Workers.begin(), m_Workers.end(), [](auto& worker) { worker->SetStopped(); });
 	std::for_each(m_Workers.begin(), m_Workers.end(), [](auto& worker) {
 		while (!worker->IsFinished())
+		{
 			worker->WakeUp();
+			std::this_thread::yield();
+		}
+	});
+	// Workers steal from each other, so none is released before all have exited
+	std::for_each(m_Workers.begin(), m_Workers.end(), [](auto& worker) {
+		for (auto& queue : worker->m_Jobs)
+		{
+			while (queue.Pop()) {}
+		}
 		delete worker;
 	});
 	m_Workers.clear();
 
-	std::for_each(m_FreeFibers.begin(), m_FreeFibers.end(), [this](auto& fiber) { 
-		Fiber::DestroyFiber(fiber->m_Fiber);
-		fiber->~FiberDesc(); 
-		m_FiberAllocator.deallocate(fiber, 1); 
-	});
-	m_FreeFibers.clear();
+	for (auto& freeFibers : m_FreeFibers)
+	{
+		std::for_each(freeFibers.begin(), freeFibers.end(), [this](auto& fiber) { DestroyFiber(fiber); });
+		freeFibers.clear();
+	}
+
+	for (JobEpoch* epoch : m_FreeEpochs)
+		delete epoch;
+	m_FreeEpochs.clear();
 
-	m_Jobs.clear();
+	m_Jobs.Clear();
+	m_DeadlineJobs.Clear();
 	m_ReadyFibers.clear();
-	m_LoopFibers.clear();
+}
+
+void FiberScheduler::SetStackSize(Job::StackSize size, uint32 bytes)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	ASSERT(m_FreeFibers[(int)size].empty());
+	m_StackSizes[(int)size] = bytes;
+}
+
+void FiberScheduler::SetDefaultStackSize(Job::StackSize size)
+{
+	ASSERT(size < Job::StackSize::STACK_MAX);
+	m_DefaultStackSize = (uint8)size;
+}
+
+uint8 FiberScheduler::GetStackSize(const Job* job) const
+{
+	uint8 stackSize = job->GetStackSize();
+	return stackSize == (uint8)Job::StackSize::STACK_DEFAULT ? m_DefaultStackSize : stackSize;
+}
+
+void FiberScheduler::SetIdlePolicy(const IdlePolicy& policy)
+{
+	m_IdlePolicy.store(policy, std::memory_order_relaxed);
+}
+
+void FiberScheduler::SetIdlePolicy(IdlePolicy::Preset preset)
+{
+	m_IdlePolicy.store(IdlePolicy::FromPreset(preset), std::memory_order_relaxed);
+}
+
+IdleStats FiberScheduler::GetIdleStats() const
+{
+	IdleStats total;
+	for (auto& worker : m_Workers)
+	{
+		IdleStats stats = worker->GetIdleStats();
+		total.m_SpinNS += stats.m_SpinNS;
+		total.m_YieldNS += stats.m_YieldNS;
+		total.m_ParkNS += stats.m_ParkNS;
+		total.m_ParkCount += stats.m_ParkCount;
+	}
+	return total;
+}
+
+SchedulerStats FiberScheduler::GetStats() const
+{
+	SchedulerStats stats;
+	stats.m_Workers.resize(m_Workers.size());
+	stats.m_QueueLatency.resize((SIZET)Job::Priority::PRIO_MAX);
+	stats.m_RunTime.resize((SIZET)Job::Priority::PRIO_MAX);
+	for (SIZET i = 0; i < m_Workers.size(); ++i)
+	{
+		WorkerStats& worker = stats.m_Workers[i];
+		m_Workers[i]->m_Metrics.CopyTo(worker, stats);
+		IdleStats idle = m_Workers[i]->GetIdleStats();
+		worker.m_IdleNS = idle.m_SpinNS + idle.m_YieldNS + idle.m_ParkNS;
+		worker.m_ParkNS = idle.m_ParkNS;
+		worker.m_ParkCount = idle.m_ParkCount;
+		stats.m_Total.Merge(worker);
+	}
+	return stats;
+}
+
+void FiberScheduler::SetIdleStackLimit(uint32 count)
+{
+	m_IdleStackLimit = count;
+}
+
+SIZET FiberScheduler::ReleaseIdleStacks()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	SIZET released = 0;
+	for (auto& freeFibers : m_FreeFibers)
+	{
+		for (auto& fiber : freeFibers)
+		{
+			if (!fiber->m_StackReleased)
+			{
+				released += Fiber::ReleaseUnusedStack(fiber->m_Fiber);
+				fiber->m_StackReleased = true;
+			}
+		}
+	}
+	return released;
 }
 
 FiberJobPtr FiberScheduler::PostJob(std::shared_ptr<Job> job, uint64 worker)
 {
-	return _PostJob(job, worker, true);
+	JobRecord* record = m_JobPool.Allocate();
+	record->m_Job.SetJob(std::move(job));
+	return _PostJob(record, nullptr, worker, true);
 }
 
-FiberJobPtr FiberScheduler::PostJob(std::shared_ptr<Job> job, JobSignalPtr signal, uint64 worker)
+FiberJobPtr FiberScheduler::PostJob(std::shared_ptr<Job> job, const JobSignalPtr& signal, uint64 worker)
 {
-	return _PostJob(job, signal, worker, true);
+	JobRecord* record = m_JobPool.Allocate();
+	record->m_Job.SetJob(std::move(job));
+	return _PostJob(record, signal.get(), worker, true);
 }
 
-void FiberScheduler::YieldFor(JobSignalPtr signal)
+void FiberScheduler::YieldFor(const JobSignalPtr& signal)
 {
-	std::unique_lock<std::mutex> lock(signal->m_Mutex);
 	if (!signal->IsValid())
 		return;
-	lock.unlock();
 	FiberDesc* selfFiber = FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber;
 
-	_PostJob(std::allocate_shared<FuncJob>(m_JobAllocator, [this, selfFiber]() {
-		std::lock_guard<std::mutex> lock(m_JobLock);
+	_PostFuncJob<FuncJob>([this, selfFiber]() {
 		uint32 workerID = selfFiber->m_CurrentJob->GetWorkerID();
-		m_ReadyFibers[workerID].push_back(selfFiber);
-		m_Workers[workerID]->WakeUp();
+		PushReadyFiber(selfFiber, workerID);
+		WakeUpWorkers(m_Workers[workerID]->GetThreadFilterID(), 1);
 		return 0;
-	}), signal, ThreadWorkerFilter::E_WORKER_ON_ANY, true);
-
-	FiberDesc* newFiber = FetchFiber(true);
-	FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber = newFiber;
-	Fiber::SwitchTo(newFiber->m_Fiber);
-	FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber = selfFiber;
+	}, signal.get(), ThreadWorkerFilter::E_WORKER_ON_ANY);
+	SuspendFiber();
 }
 
 void FiberScheduler::YieldPoll(uint32 intervalMS)
+{
+	YieldPoll(TimerUS((uint64)intervalMS * 1000));
+}
+
+void FiberScheduler::YieldPoll(TimerUS interval)
 {
 	bool hasJob = HasJobReady(ThreadWorker::GetCurrentThreadFilter());
-	if (intervalMS == 0 && !hasJob)
+	if (interval.count() <= 0 && !hasJob)
 		return;
 	
-	FiberDesc* selfFiber = FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber;
-	selfFiber->StartCounter();
-	selfFiber->m_LoopMS = intervalMS;
-	{				
-		uint32 currentWorkerID = ThreadWorker::GetCurrentThreadID();
-		ASSERT(!m_LoopFibers[currentWorkerID]);
-		m_LoopFibers[currentWorkerID] = selfFiber;
-		std::lock_guard<std::mutex> lock(m_JobLock);
-		_PushJobPending(1, ThreadWorker::GetCurrentThreadFilter());
-	}
+	// The fiber comes back on this worker once the interval is over, after a pending job has run
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	FiberDesc* selfFiber = worker->m_CurrentFiber;
+	selfFiber->m_TimerNode.m_Fiber = selfFiber;
+	selfFiber->m_TimerNode.m_DeadlineUS = TimerWheel::Now() + (uint64)(TMAX(interval.count(), (TimerUS::rep)0));
+	worker->m_Timers.Insert(&selfFiber->m_TimerNode);
+	_PushJobPending(1, ThreadWorker::GetCurrentThreadFilter());
+	SuspendFiber();
+}
 
-	FiberDesc* newFiber = FetchFiber(false);
+void FiberScheduler::SuspendFiber()
+{
+	FiberDesc* selfFiber = FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber;
+#if defined(__TRACING__)
+	FiberJob* job = selfFiber->m_CurrentJob;
+	FIBER_TRACE(FIBER_SUSPEND, job ? job->GetID() : 0, job ? job->GetJob()->GetName() : nullptr, 0);
+#endif
+	FiberDesc* newFiber = FetchFiber();
+	FiberWorker::GetCurrentThreadWorker()->m_Metrics.AddContextSwitch();
 	FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber = newFiber;
 	Fiber::SwitchTo(newFiber->m_Fiber);
 	FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber = selfFiber;
+	FreeDeferredFiber();
+	FIBER_TRACE(FIBER_RESUME, job ? job->GetID() : 0, job ? job->GetJob()->GetName() : nullptr, 0);
 }
 
-void FiberScheduler::WakeUpWorkers(uint64 workerFilter)
+void FiberScheduler::WakeUpWorkers(uint64 workerFilter, uint32 count)
 {
-	std::for_each(m_Workers.begin(), m_Workers.end(), [workerFilter](auto& worker) {
-		if (worker->GetThreadFilterID() & workerFilter)
-			worker->WakeUp(); 
-	});
+	// Pairs with the fence in ParkWorker, either the sleeper sees the new work or we see the sleeper
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	uint64 parked = m_ParkedWorkers.load(std::memory_order_relaxed) & workerFilter;
+	while (parked && count > 0)
+	{
+		uint64 bit = parked & (~parked + 1);
+		parked &= parked - 1;
+		// Whoever clears the bit owns the wakeup, running and spinning workers are never signaled
+		if (m_ParkedWorkers.fetch_and(~bit, std::memory_order_acq_rel) & bit)
+		{
+			m_Workers[CountTrailingZeros64(bit)]->WakeUp();
+			--count;
+		}
+	}
+}
+
+void FiberScheduler::ParkWorker(FiberWorker* worker, uint64 timeUS)
+{
+	uint64 bit = worker->GetThreadFilterID();
+	worker->PrepareToPark();
+	m_ParkedWorkers.fetch_or(bit, std::memory_order_seq_cst);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	// Work pushed before we were registered didn't wake anybody, look once more
+	IoRing* ring = worker->GetIoRing(false);
+	Reactor* reactor = worker->GetReactor(false);
+	if (worker->m_ReadyFiberCount == 0 && !HasJobReady(bit) && !worker->m_Timers.HasPosted() && !(ring && ring->HasCompletions()) &&
+		!(reactor && reactor->HasReady()) && !worker->IsStopped())
+	{
+		FIBER_TRACE(WORKER_PARK, worker->GetThreadID(), nullptr, 0);
+		worker->Park(timeUS);
+		FIBER_TRACE(WORKER_UNPARK, worker->GetThreadID(), nullptr, 0);
+	}
+	else
+		worker->WakeUp();
+	m_ParkedWorkers.fetch_and(~bit, std::memory_order_relaxed);
 }
 
 FiberDesc* FiberScheduler::FetchFiber(bool lock)
 {
+	return FetchFiber(m_DefaultStackSize, lock);
+}
+
+FiberDesc* FiberScheduler::FetchFiber(uint8 stackSize, bool lock)
+{
+	auto& freeFibers = m_FreeFibers[stackSize];
+
 	if (lock) m_Lock.lock();
-	if (m_FreeFibers.empty())
+	if (freeFibers.empty())
 	{
 		FiberDesc* fiber = new (m_FiberAllocator.allocate(1)) FiberDesc();
-		fiber->StartCounter();
-		fiber->m_Fiber = Fiber::CreateFiber(64 * 1024, FiberScheduler::Poll, fiber);
+		fiber->m_StackSize = stackSize;
+		fiber->m_Fiber = Fiber::CreateFiber(m_StackSizes[stackSize], FiberScheduler::Poll, fiber);
+		if (!fiber->m_Fiber)
+		{
+			fprintf(stderr, "FiberScheduler: failed to create a fiber with a %u byte stack\n", m_StackSizes[stackSize]);
+			abort();
+		}
 		fiber->m_Scheduler = this;
 		if (lock) m_Lock.unlock();
+		if (FiberWorker* worker = FiberWorker::GetCurrentThreadWorker())
+			worker->m_Metrics.AddFiberCreated();
 		return fiber;
 	}
-	FiberDesc* fiber = m_FreeFibers.back();
-	m_FreeFibers.pop_back();	
+	FiberDesc* fiber = freeFibers.back();
+	freeFibers.pop_back();	
+	fiber->m_StackReleased = false;
+	fiber->m_Scheduler = this;
 
 	if (lock) m_Lock.unlock();
+	if (FiberWorker* worker = FiberWorker::GetCurrentThreadWorker())
+		worker->m_Metrics.AddFiberReused();
 	return fiber;
 }
 
@@ -212,79 +460,233 @@ void FiberScheduler::FreeFiber(FiberDesc* fiber, bool lock)
 	ASSERT(fiber->m_Fiber);
 	fiber->m_Scheduler = nullptr;
 	fiber->m_CurrentJob = nullptr;
-	fiber->m_LoopMS = 0;
-	m_FreeFibers.push_back(fiber);
+	fiber->m_TimerNode = TimerNode();
+
+	// Beyond the idle limit pooled fibers keep their address range but give their pages back
+	auto& freeFibers = m_FreeFibers[fiber->m_StackSize];
+	if (freeFibers.size() >= m_IdleStackLimit)
+	{
+		Fiber::ReleaseUnusedStack(fiber->m_Fiber);
+		fiber->m_StackReleased = true;
+	}
+	freeFibers.push_back(fiber);
 	if (lock) m_Lock.unlock();
 }
 
+void FiberScheduler::DestroyFiber(FiberDesc* fiber)
+{
+	Fiber::DestroyFiber(fiber->m_Fiber);
+	fiber->~FiberDesc();
+	m_FiberAllocator.deallocate(fiber, 1);
+}
+
+void FiberScheduler::FreeDeferredFiber()
+{
+	// A fiber can't be handed out while its stack is still in use, so a fiber
+	// leaving itself is only freed by the one that runs after it.
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	if (worker->m_DeferredFiber)
+	{
+		FreeFiber(worker->m_DeferredFiber);
+		worker->m_DeferredFiber = nullptr;
+	}
+}
+
 JobSignalPtr FiberScheduler::FetchSignal()
 {
-	return std::allocate_shared<JobSignal>(m_SignalAllocator, this);
+	JobRecord* record = m_JobPool.Allocate();
+	record->m_Signal.m_Scheduler = this;
+	record->m_Holds.store(1, std::memory_order_relaxed);
+	return JobSignalPtr::Adopt(record);
 }
 
-void FiberScheduler::AddPreCondition(JobSignalPtr signal, JobSignalPtr condition)
+void FiberScheduler::AddPreCondition(const JobSignalPtr& signal, const JobSignalPtr& condition)
 {	
-	condition->AddTrigger(signal);
+	condition->AddTrigger(signal.get());
 }
 
-void FiberScheduler::PushJob(FiberJobPtr fiberJob, bool lock)
+void FiberScheduler::PushJob(FiberJob* fiberJob, bool lock)
 {	
-	if (lock) m_JobLock.lock();
 	fiberJob->SetStatus(Job::Status::STATUS_READY);
-	auto& jobQueue = m_Jobs[fiberJob->GetWorkerFilter()];
-	if (jobQueue.empty())
-		jobQueue.resize((int)Job::Priority::PRIO_MAX);
-	jobQueue[fiberJob->m_Job->GetPriority()].push_back(fiberJob);
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	uint64 workerFilter = fiberJob->GetWorkerFilter();
+	if (!fiberJob->HasDeadline() && IsStealable(worker, workerFilter))
+	{
+		worker->m_Jobs[fiberJob->GetJob()->GetPriority()].Push(fiberJob);
+		// Only thieves can take it from our deque
+		WakeUpWorkers(workerFilter & m_StealMask, 1);
+		return;
+	}
+
+	if (lock) m_JobLock.lock();
+	if (fiberJob->HasDeadline())
+		m_DeadlineJobs.Push(fiberJob);
+	else
+		m_Jobs.Push(fiberJob);
 	if (lock) m_JobLock.unlock();
-	WakeUpWorkers(fiberJob->GetWorkerFilter());
+	WakeUpWorkers(workerFilter, 1);
 }
 
-FiberJobPtr FiberScheduler::PopJob(uint64 workerFilter)
+void FiberScheduler::PushJobs(FiberJob** fiberJobs, SIZET count)
 {
-	for (auto& jobQueue : m_Jobs)
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	uint64 wakeFilter = 0;
+	for (SIZET i = 0; i < count; ++i)
+		fiberJobs[i]->SetStatus(Job::Status::STATUS_READY);
+
+	// Stealable jobs go first, grouped by priority so each run is published to the deque at once
+	FiberJob** shared = std::stable_partition(fiberJobs, fiberJobs + count, [this, worker, &wakeFilter](FiberJob* job) {
+		bool stealable = !job->HasDeadline() && IsStealable(worker, job->GetWorkerFilter());
+		wakeFilter |= stealable ? job->GetWorkerFilter() & m_StealMask : job->GetWorkerFilter();
+		return stealable;
+	});
+	auto byPriority = [](FiberJob* a, FiberJob* b) { return a->GetJob()->GetPriority() < b->GetJob()->GetPriority(); };
+	if (!std::is_sorted(fiberJobs, shared, byPriority))
+		std::stable_sort(fiberJobs, shared, byPriority);
+	for (FiberJob** run = fiberJobs; run != shared;)
+	{
+		uint8 prio = (*run)->GetJob()->GetPriority();
+		FiberJob** end = std::find_if(run, shared, [prio](FiberJob* job) { return job->GetJob()->GetPriority() != prio; });
+		worker->m_Jobs[prio].PushRange(run, end - run);
+		run = end;
+	}
+
+	if (shared != fiberJobs + count)
 	{
-		if (jobQueue.first & workerFilter)
+		std::lock_guard<std::mutex> lock(m_JobLock);
+		for (FiberJob** job = shared; job != fiberJobs + count; ++job)
 		{
-			for (auto& jobs : jobQueue.second)
-			{
-				if (!jobs.empty())
-				{
-					FiberJobPtr job = jobs.back();
-					jobs.pop_back();
-					return job;
-				}
-			}
+			if ((*job)->HasDeadline())
+				m_DeadlineJobs.Push(*job);
+			else
+				m_Jobs.Push(*job);
 		}
 	}
+	WakeUpWorkers(wakeFilter, (uint32)(TMIN(count, (SIZET)THREAD_COUNT_MAX)));
+}
+
+FiberJob* FiberScheduler::PopJob(uint64 workerFilter)
+{
+	// Stale jobs are dropped here, before they cost a fiber or a stack handoff
+	while (FiberJob* job = PopReadyJob(workerFilter))
+	{
+		if (!job->IsTimeout())
+			return job;
+		job->SetStatus(Job::Status::STATUS_EXPIRED);
+		_FinishJob(job, 0);
+	}
 	return nullptr;
 }
 
+FiberJob* FiberScheduler::PopReadyJob(uint64 workerFilter)
+{
+	// Jobs with a deadline come before any priority
+	if (FiberJob* job = PopDeadlineJob(workerFilter))
+		return job;
+
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	if (worker && worker->m_Scheduler == this)
+	{
+		for (auto& queue : worker->m_Jobs)
+		{
+			if (FiberJob* job = queue.Pop())
+				return job;
+		}
+	}
+
+	FiberJob* job = PopSharedJob(workerFilter);
+	if (!job && worker && (worker->GetThreadFilterID() & m_StealMask))
+		job = StealJob(worker);
+	return job;
+}
+
 FiberDesc* FiberScheduler::PopFiber(uint32 workerID)
 {
+	FiberWorker* worker = m_Workers[workerID];
+	if (worker->m_ReadyFiberCount == 0)
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(m_JobLock);
 	auto& fiberQueue = m_ReadyFibers[workerID];
 	if (!fiberQueue.empty())
 	{
 		FiberDesc* readyFiber = fiberQueue.back();
 		fiberQueue.pop_back();
+		worker->m_ReadyFiberCount--;
 		return readyFiber;
 	}
 	return nullptr;
 }
 
-FiberDesc* FiberScheduler::PopLoopFiber(uint32 workerID, int32& remainMS)
+FiberDesc* FiberScheduler::PopTimerFiber(FiberWorker* worker, uint64& remainUS)
+{
+	uint64 now = TimerWheel::Now();
+	TimerNode* node = worker->m_Timers.Advance(now);
+	FiberDesc* fiber = nullptr;
+	while (node)
+	{
+		TimerNode* next = node->m_Next;
+		if (node->m_Fiber)
+		{
+			// Run the first polling fiber now, the others as ready fibers of this worker
+			if (!fiber)
+				fiber = node->m_Fiber;
+			else
+				PushReadyFiber(node->m_Fiber, worker->GetThreadID());
+		}
+		else if (node->m_Job->GetJob()->IsAborted())
+		{
+			node->m_Job->SetStatus(Job::Status::STATUS_EXPIRED);
+			node->m_Job->GetJobSignal()->Trigger(0);
+		}
+		else
+		{
+			node->m_Job->StartCounter();
+			PushJob(node->m_Job);
+		}
+		node = next;
+	}
+	remainUS = worker->m_Timers.GetRemainTime(now);
+	return fiber;
+}
+
+FiberDesc* FiberScheduler::PopIoFiber(FiberWorker* worker, bool flush)
 {
-	FiberDesc* fiber = m_LoopFibers[workerID];
-	if (fiber)
+	// Submissions wait for a full batch and sockets for the reactor's interval unless the worker
+	// is about to go idle
+	IoRequest* requests[2] = { nullptr, nullptr };
+	IoRing* ring = worker->GetIoRing(false);
+	if (ring && ring->IsBusy())
 	{
-		remainMS = fiber->GetRemainTime();
-		if (remainMS <= 0)
+		ring->Submit(flush);
+		requests[0] = ring->Reap();
+	}
+	Reactor* reactor = worker->GetReactor(false);
+	if (reactor && reactor->IsBusy())
+		requests[1] = reactor->Poll(flush);
+
+	FiberDesc* fiber = nullptr;
+	for (IoRequest* request : requests)
+	{
+		while (request)
 		{
-			remainMS = 0;
-			m_LoopFibers[workerID] = nullptr;
-			return fiber;
+			// The request lives on the fiber's stack, so it is done with before the fiber may run
+			IoRequest* next = request->m_Next;
+			if (!fiber)
+				fiber = request->m_Fiber;
+			else
+				PushReadyFiber(request->m_Fiber, worker->GetThreadID());
+			request = next;
 		}
 	}
-	return nullptr;
+	return fiber;
+}
+
+void FiberScheduler::PushReadyFiber(FiberDesc* fiber, uint32 workerID)
+{
+	std::lock_guard<std::mutex> lock(m_JobLock);
+	m_ReadyFibers[workerID].push_back(fiber);
+	m_Workers[workerID]->m_ReadyFiberCount++;
 }
 
 FiberWorker* FiberScheduler::GetWorkerByID(uint32 id)
@@ -297,66 +699,186 @@ FiberWorker* FiberScheduler::GetWorkerByID(uint32 id)
 	return nullptr;
 }
 
-bool FiberScheduler::HasJobReady(uint64 workerFilter, bool lock)
+bool FiberScheduler::HasJobReady(uint64 workerFilter)
 {
-	if (lock) m_JobLock.lock();
-	for (auto& jobQueue : m_Jobs)
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	if (worker && worker->m_Scheduler == this)
 	{
-		if (jobQueue.first & workerFilter)
+		bool thief = (worker->GetThreadFilterID() & m_StealMask) != 0;
+		for (auto& victim : m_Workers)
 		{
-			for (auto& jobs : jobQueue.second)
+			if (victim != worker && !thief)
+				continue;
+			for (auto& queue : victim->m_Jobs)
 			{
-				if (!jobs.empty())
-				{
-					if (lock) m_JobLock.unlock();
+				if (!queue.IsEmpty())
 					return true;
-				}
 			}
 		}
 	}
-	if (lock) m_JobLock.unlock();
-	return false;
+	return m_Jobs.HasJob(workerFilter) || m_DeadlineJobs.HasJob(workerFilter);
+}
+
+bool FiberScheduler::IsStarving(uint64 workerFilter)
+{
+	// Nothing queued that the workers of the filter could take, so new work would not wait
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	if (IsStealable(worker, workerFilter))
+	{
+		for (auto& queue : worker->m_Jobs)
+		{
+			if (!queue.IsEmpty())
+				return false;
+		}
+		return true;
+	}
+	return !m_Jobs.HasJob(workerFilter);
+}
+
+bool FiberScheduler::IsWorkerOf(uint64 workerFilter) const
+{
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	return worker && worker->m_Scheduler == this && (worker->GetThreadFilterID() & workerFilter);
 }
 
-FiberJobPtr FiberScheduler::PopPendingJob(uint32 workerID)
+FiberJob* FiberScheduler::PopPendingJob(uint32 workerID)
 {
 	if (!m_PendingJobs[workerID].empty())
 	{
-		FiberJobPtr job = m_PendingJobs[workerID].back();
+		FiberJob* job = m_PendingJobs[workerID].back();
 		m_PendingJobs[workerID].pop_back();
 		return job;
 	}
 	return nullptr;
 }
 
-FiberJobPtr FiberScheduler::_PostJob(std::shared_ptr<Job> job, uint64 worker, bool lock)
+void FiberScheduler::_InitJob(JobRecord* record, uint64 worker)
 {
-	FiberJobPtr fiberJob = std::allocate_shared<FiberJob>(m_JobAllocator, FiberJob(this, job));
+	FiberJob* fiberJob = &record->m_Job;
+	fiberJob->m_Scheduler = this;
 	fiberJob->m_WorkerFilter = worker;
 	fiberJob->StartCounter();
-	PushJob(fiberJob, lock);
-	return fiberJob;
+#if defined(__TRACING__)
+	if (!fiberJob->GetJob()->GetName())
+		fiberJob->GetJob()->SetName(FiberTrace::JobNameScope::GetCurrent());
+	FIBER_TRACE(JOB_POST, fiberJob->GetID(), fiberJob->GetJob()->GetName(), 0);
+#endif
+
+	// The armed signal holds the record until the job has run
+	record->m_Signal.m_Scheduler = this;
+	record->m_Signal.Arm();
 }
 
-FiberJobPtr FiberScheduler::_PostJob(std::shared_ptr<Job> job, JobSignalPtr signal, uint64 worker, bool lock)
+FiberJobPtr FiberScheduler::_PostJob(JobRecord* record, JobSignal* signal, uint64 worker, bool lock)
 {
-	FiberJobPtr fiberJob = std::allocate_shared<FiberJob>(m_JobAllocator, FiberJob(this, job));
-	fiberJob->m_WorkerFilter = worker;
-	fiberJob->StartCounter();
-	std::lock_guard<std::mutex> signalLock(signal->m_Mutex);
-	if (signal->IsValid())
-		signal->PushJob(fiberJob, false);
-	else
+	record->m_Holds.store(1, std::memory_order_relaxed);
+	_InitJob(record, worker);
+	FiberJobPtr handle = FiberJobPtr::Adopt(record);
+
+	FiberJob* fiberJob = &record->m_Job;
+	if (!signal || !signal->PushJob(fiberJob))
 		PushJob(fiberJob, lock);
-	return fiberJob;
+	return handle;
+}
+
+FiberJobPtr FiberScheduler::_PostTimedJob(JobRecord* record, uint64 deadlineUS, uint64 periodUS, uint64 worker)
+{
+	record->m_Holds.store(1, std::memory_order_relaxed);
+	_InitJob(record, worker);
+	FiberJobPtr handle = FiberJobPtr::Adopt(record);
+
+	FiberJob* fiberJob = &record->m_Job;
+	fiberJob->m_PeriodUS = periodUS;
+	fiberJob->m_TimerNode.m_Job = fiberJob;
+	fiberJob->m_TimerNode.m_DeadlineUS = deadlineUS;
+	fiberJob->SetStatus(Job::Status::STATUS_SUSPEND);
+	_AddTimer(&fiberJob->m_TimerNode, worker);
+	return handle;
+}
+
+void FiberScheduler::_AddTimer(TimerNode* node, uint64 workerFilter)
+{
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	if (worker && worker->m_Scheduler == this)
+	{
+		worker->m_Timers.Insert(node);
+		return;
+	}
+
+	uint64 owners = workerFilter & m_WorkerMask;
+	FiberWorker* owner = m_Workers[owners ? CountTrailingZeros64(owners) : 0];
+	owner->m_Timers.Post(node);
+	// A parked owner has to pick its next timeout again
+	WakeUpWorkers(owner->GetThreadFilterID(), 1);
+}
+
+void FiberScheduler::_FinishJob(FiberJob* fiberJob, int32 result)
+{
+	// An expired run of a recurring job only skips that period
+	if (fiberJob->IsRecurring() && result == 0 && !fiberJob->GetJob()->IsAborted())
+		_RepeatJob(fiberJob);
+	else
+		fiberJob->GetJobSignal()->Trigger(result);	// the record may be recycled as soon as its signal fires
+}
+
+void FiberScheduler::_RepeatJob(FiberJob* fiberJob)
+{
+	// Keep the period from the last deadline so runs don't drift, but never catch up on missed ones
+	TimerNode& node = fiberJob->m_TimerNode;
+	node.m_DeadlineUS = TMAX(node.m_DeadlineUS + fiberJob->m_PeriodUS, TimerWheel::Now());
+	fiberJob->SetStatus(Job::Status::STATUS_SUSPEND);
+	FiberWorker::GetCurrentThreadWorker()->m_Timers.Insert(&node);
+}
+
+bool FiberScheduler::IsStealable(FiberWorker* worker, uint64 workerFilter) const
+{
+	// Only a worker may push to its own queue, and the job must be runnable by the owner and every thief
+	return worker && worker->m_Scheduler == this
+		&& (worker->GetThreadFilterID() & workerFilter)
+		&& (workerFilter & m_StealMask) == m_StealMask;
+}
+
+FiberJob* FiberScheduler::PopSharedJob(uint64 workerFilter)
+{
+	if (!m_Jobs.HasJob(workerFilter))
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(m_JobLock);
+	return m_Jobs.Pop(workerFilter);
+}
+
+FiberJob* FiberScheduler::PopDeadlineJob(uint64 workerFilter)
+{
+	if (!m_DeadlineJobs.HasJob(workerFilter))
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(m_JobLock);
+	return m_DeadlineJobs.Pop(workerFilter, TimerWheel::Now());
+}
+
+FiberJob* FiberScheduler::StealJob(FiberWorker* thief)
+{
+	for (SIZET prio = 0; prio < (SIZET)Job::Priority::PRIO_MAX; ++prio)
+	{
+		for (FiberWorker* victim : thief->m_Victims)
+		{
+			if (FiberJob* job = victim->m_Jobs[prio].Steal())
+			{
+				FIBER_TRACE(JOB_STEAL, job->GetID(), job->GetJob()->GetName(), victim->GetThreadID());
+				thief->m_Metrics.AddSteal();
+				return job;
+			}
+		}
+	}
+	return nullptr;
 }
 
 void FiberScheduler::_PushJobPending(int32 count, uint64 workerFilter)
 {
 	while (--count >= 0)
 	{
-		FiberJobPtr job = PopJob(workerFilter);
-		if (job.get())
+		FiberJob* job = PopJob(workerFilter);
+		if (job)
 		{
 			m_PendingJobs[ThreadWorker::GetCurrentThreadID()].push_back(job);
 		}
@@ -0,0 +1,270 @@
+// FiberSync.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/FiberSync.h"
+#include "Fiber/FiberScheduler.h"
+#include "Fiber/FiberWorker.h"
+#include "Futex.h"
+
+
+FiberWaiter::FiberWaiter()
+{
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	if (worker && worker->m_Scheduler && worker->m_CurrentFiber)
+	{
+		m_Fiber = worker->m_CurrentFiber;
+		m_WorkerID = worker->GetThreadID();
+	}
+}
+
+void FiberWaiter::Suspend()
+{
+	if (m_Fiber)
+	{
+		// A Resume that came first only queued the fiber on its worker, which is running us
+		m_Fiber->m_Scheduler->SuspendFiber();
+		return;
+	}
+	while (m_Woken.load(std::memory_order_acquire) == 0)
+		Futex::Wait(m_Woken, 0);
+}
+
+void FiberWaiter::Resume()
+{
+	FiberDesc* fiber = m_Fiber;
+	if (fiber)
+	{
+		uint32 workerID = m_WorkerID;
+		FiberScheduler* scheduler = fiber->m_Scheduler;
+		scheduler->PushReadyFiber(fiber, workerID);
+		scheduler->WakeUpWorkers((uint64)1 << workerID, 1);
+		return;
+	}
+	m_Woken.store(1, std::memory_order_release);
+	Futex::Wake(m_Woken);
+}
+
+
+void FiberWaitQueue::Lock()
+{
+	while (m_Lock.exchange(true, std::memory_order_acquire))
+	{
+		while (m_Lock.load(std::memory_order_relaxed))
+			CpuPause();
+	}
+}
+
+void FiberWaitQueue::Push(FiberWaiter* waiter)
+{
+	waiter->m_Next = nullptr;
+	if (m_Tail)
+		m_Tail->m_Next = waiter;
+	else
+		m_Head = waiter;
+	m_Tail = waiter;
+}
+
+FiberWaiter* FiberWaitQueue::Pop()
+{
+	FiberWaiter* waiter = m_Head;
+	if (waiter)
+	{
+		m_Head = waiter->m_Next;
+		if (!m_Head)
+			m_Tail = nullptr;
+	}
+	return waiter;
+}
+
+FiberWaiter* FiberWaitQueue::PopAll()
+{
+	FiberWaiter* waiter = m_Head;
+	m_Head = nullptr;
+	m_Tail = nullptr;
+	return waiter;
+}
+
+/*static*/ void FiberWaitQueue::ResumeAll(FiberWaiter* waiter)
+{
+	while (waiter)
+	{
+		FiberWaiter* next = waiter->m_Next;
+		waiter->Resume();
+		waiter = next;
+	}
+}
+
+
+void FiberMutex::Lock()
+{
+	if (TryLock())
+		return;
+	for (uint32 i = 0; i < FiberWaitQueue::SPIN_COUNT; ++i)
+	{
+		CpuPause();
+		if (m_State.load(std::memory_order_relaxed) == UNLOCKED && TryLock())
+			return;
+	}
+
+	FiberWaiter waiter;
+	m_Waiters.Lock();
+	// Marking it contended under the queue lock means the owner's Unlock will look at the queue
+	if (m_State.exchange(CONTENDED, std::memory_order_acquire) == UNLOCKED)
+	{
+		m_Waiters.Unlock();
+		return;
+	}
+	m_Waiters.Push(&waiter);
+	m_Waiters.Unlock();
+	// Owned once resumed, Unlock handed it over without releasing it
+	waiter.Suspend();
+}
+
+bool FiberMutex::TryLock()
+{
+	uint32 expected = UNLOCKED;
+	return m_State.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+void FiberMutex::Unlock()
+{
+	uint32 expected = LOCKED;
+	if (m_State.compare_exchange_strong(expected, UNLOCKED, std::memory_order_release, std::memory_order_relaxed))
+		return;
+
+	m_Waiters.Lock();
+	FiberWaiter* waiter = m_Waiters.Pop();
+	if (waiter)
+		m_State.store(m_Waiters.IsEmpty() ? LOCKED : CONTENDED, std::memory_order_release);
+	else
+		m_State.store(UNLOCKED, std::memory_order_release);
+	m_Waiters.Unlock();
+	if (waiter)
+		waiter->Resume();
+}
+
+
+void FiberConditionVariable::Wait(FiberMutex& mutex)
+{
+	FiberWaiter waiter;
+	m_Waiters.Lock();
+	m_Waiters.Push(&waiter);
+	m_Waiters.Unlock();
+	mutex.Unlock();
+	waiter.Suspend();
+	mutex.Lock();
+}
+
+void FiberConditionVariable::NotifyOne()
+{
+	m_Waiters.Lock();
+	FiberWaiter* waiter = m_Waiters.Pop();
+	m_Waiters.Unlock();
+	if (waiter)
+		waiter->Resume();
+}
+
+void FiberConditionVariable::NotifyAll()
+{
+	m_Waiters.Lock();
+	FiberWaiter* waiters = m_Waiters.PopAll();
+	m_Waiters.Unlock();
+	FiberWaitQueue::ResumeAll(waiters);
+}
+
+
+void FiberSemaphore::Acquire()
+{
+	for (uint32 i = 0; i < FiberWaitQueue::SPIN_COUNT; ++i)
+	{
+		if (TryAcquire())
+			return;
+		CpuPause();
+	}
+
+	FiberWaiter waiter;
+	m_Waiters.Lock();
+	// Either Release sees the waiter count, or we see its permit here. TryAcquire loads the
+	// count relaxed, the fence keeps that load from reading a value older than our increment.
+	m_WaiterCount.fetch_add(1, std::memory_order_seq_cst);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (TryAcquire())
+	{
+		m_WaiterCount.fetch_sub(1, std::memory_order_relaxed);
+		m_Waiters.Unlock();
+		return;
+	}
+	m_Waiters.Push(&waiter);
+	m_Waiters.Unlock();
+	// Resumed with the permit Release took for us
+	waiter.Suspend();
+}
+
+bool FiberSemaphore::TryAcquire()
+{
+	int32 count = m_Count.load(std::memory_order_relaxed);
+	while (count > 0)
+	{
+		if (m_Count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+			return true;
+	}
+	return false;
+}
+
+void FiberSemaphore::Release(int32 count)
+{
+	m_Count.fetch_add(count, std::memory_order_seq_cst);
+	if (m_WaiterCount.load(std::memory_order_seq_cst) == 0)
+		return;
+
+	// Permits taken here go to the waiters in queue order, fast path acquirers may have taken the others
+	FiberWaitQueue resumed;
+	m_Waiters.Lock();
+	while (!m_Waiters.IsEmpty() && TryAcquire())
+	{
+		resumed.Push(m_Waiters.Pop());
+		m_WaiterCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+	m_Waiters.Unlock();
+	FiberWaitQueue::ResumeAll(resumed.PopAll());
+}
+
+
+bool FiberBarrier::ArriveAndWait()
+{
+	m_Waiters.Lock();
+	uint32 phase = m_Phase.load(std::memory_order_relaxed);
+	if (++m_Arrived == m_Count)
+	{
+		m_Arrived = 0;
+		m_Phase.store(phase + 1, std::memory_order_release);
+		FiberWaiter* waiters = m_Waiters.PopAll();
+		m_Waiters.Unlock();
+		FiberWaitQueue::ResumeAll(waiters);
+		return true;
+	}
+	m_Waiters.Unlock();
+
+	for (uint32 i = 0; i < FiberWaitQueue::SPIN_COUNT; ++i)
+	{
+		if (m_Phase.load(std::memory_order_acquire) != phase)
+			return false;
+		CpuPause();
+	}
+
+	FiberWaiter waiter;
+	m_Waiters.Lock();
+	if (m_Phase.load(std::memory_order_relaxed) != phase)
+	{
+		m_Waiters.Unlock();
+		return false;
+	}
+	m_Waiters.Push(&waiter);
+	m_Waiters.Unlock();
+	waiter.Suspend();
+	return false;
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,101 @@
+// FiberTask.cpp
+//------------------------------------------------------------------------------
+#if defined(__cpp_impl_coroutine)
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/FiberTask.h"
+#include "Fiber/FiberWorker.h"
+#include <cstddef>
+#include <memory_resource>
+
+// The resource a frame came from is kept in front of it, so any thread can free it
+static constexpr SIZET FRAME_HEADER = alignof(std::max_align_t);
+
+
+bool SignalAwaiter::await_ready() const
+{
+	return !m_Signal || !m_Signal->IsValid();
+}
+
+void SignalAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	// The task may be resumed on another worker before this returns, so nothing of it is touched after
+	ASSERT(m_Scheduler);
+	m_Scheduler->PostJob([handle]() { handle.resume(); }, m_Signal, m_Worker);
+}
+
+int32 SignalAwaiter::await_resume() const
+{
+	return m_Signal ? m_Signal->m_Result.load(std::memory_order_relaxed) : 0;
+}
+
+
+TaskPromiseBase::TaskPromiseBase()
+	: m_Scheduler(nullptr)
+	, m_Worker(ThreadWorkerFilter::E_WORKER_ON_ANY_EXCEPT_MAIN)
+	, m_DoneSignal(nullptr)
+{
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	if (worker)
+		m_Scheduler = worker->m_Scheduler;
+}
+
+/*static*/ void* TaskPromiseBase::operator new(SIZET size)
+{
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	std::pmr::memory_resource* resource = worker && worker->m_Scheduler ? worker->m_Scheduler->GetFrameResource() : std::pmr::new_delete_resource();
+	void* block = resource->allocate(size + FRAME_HEADER, alignof(std::max_align_t));
+	*static_cast<std::pmr::memory_resource**>(block) = resource;
+	return static_cast<uint8*>(block) + FRAME_HEADER;
+}
+
+/*static*/ void TaskPromiseBase::operator delete(void* ptr, SIZET size)
+{
+	void* block = static_cast<uint8*>(ptr) - FRAME_HEADER;
+	std::pmr::memory_resource* resource = *static_cast<std::pmr::memory_resource**>(block);
+	resource->deallocate(block, size + FRAME_HEADER, alignof(std::max_align_t));
+}
+
+/*static*/ void TaskPromiseBase::PostResume(FiberScheduler* scheduler, std::coroutine_handle<> handle, uint64 worker)
+{
+	ASSERT(scheduler);
+	scheduler->PostJob([handle]() { handle.resume(); }, worker);
+}
+
+JobSignalPtr TaskPromiseBase::Start(std::coroutine_handle<> handle, FiberScheduler& scheduler, uint64 worker)
+{
+	ASSERT(!m_Continuation && !m_DoneSignal);
+	m_Scheduler = &scheduler;
+	m_Worker = worker;
+
+	JobSignalPtr signal = scheduler.FetchSignal();
+	signal->Arm();
+	m_DoneSignal = signal.get();
+	PostResume(m_Scheduler, handle, worker);
+	return signal;
+}
+
+std::coroutine_handle<> TaskPromiseBase::Finish() noexcept
+{
+	if (m_Continuation)
+		return m_Continuation;
+
+	// Whoever waits on the signal may destroy the frame as soon as it fires
+	if (JobSignal* signal = m_DoneSignal)
+	{
+		m_DoneSignal = nullptr;
+		signal->Trigger(m_Exception ? -1 : 0);
+	}
+	return std::noop_coroutine();
+}
+
+void TaskPromiseBase::Rethrow() const
+{
+	if (m_Exception)
+		std::rethrow_exception(m_Exception);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,245 @@
+// FiberTrace.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/FiberTrace.h"
+#include "Worker.h"
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+// Static
+//------------------------------------------------------------------------------
+namespace
+{
+	// Written by its thread only, read by the exporter which checks the head again after copying
+	struct TraceRing
+	{
+		std::atomic<uint64>  m_Head{ 0 };
+		std::atomic<uint64>  m_Start{ 0 };		// events before it were cleared
+		FiberTrace::Event*   m_Events{ nullptr };
+		char                 m_Name[48]{};
+	};
+
+	std::mutex              s_RingLock;
+	// One per thread that ever recorded, never destroyed since workers may still record during exit
+	std::vector<TraceRing*>& s_Rings = *new std::vector<TraceRing*>();
+}
+
+static THREAD_LOCAL TraceRing*  s_Ring = nullptr;
+static THREAD_LOCAL const char* s_JobName = nullptr;
+
+std::atomic<bool> FiberTrace::s_Enabled{ false };
+
+static uint64 NowNS()
+{
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static TraceRing* CreateRing()
+{
+	TraceRing* ring = new TraceRing();
+	ring->m_Events = new FiberTrace::Event[FiberTrace::RING_SIZE];
+	std::lock_guard<std::mutex> lock(s_RingLock);
+	ThreadWorker* worker = ThreadWorker::GetCurrentThreadWorker();
+	if (worker)
+		snprintf(ring->m_Name, sizeof(ring->m_Name), "%s", worker->GetThreadName().c_str());
+	else
+		snprintf(ring->m_Name, sizeof(ring->m_Name), "Thread %u", (uint32)s_Rings.size());
+	s_Rings.push_back(ring);
+	return ring;
+}
+
+static void WriteString(FILE* file, const char* text)
+{
+	fputc('"', file);
+	for (; *text; ++text)
+	{
+		if (*text == '"' || *text == '\\')
+			fputc('\\', file);
+		if ((uint8)*text >= 0x20)
+			fputc(*text, file);
+	}
+	fputc('"', file);
+}
+
+
+void FiberTrace::Enable(bool enable)
+{
+	s_Enabled.store(enable, std::memory_order_relaxed);
+}
+
+void FiberTrace::Clear()
+{
+	std::lock_guard<std::mutex> lock(s_RingLock);
+	for (TraceRing* ring : s_Rings)
+		ring->m_Start.store(ring->m_Head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+void FiberTrace::Record(EventType type, uint64 id, const char* name, uint32 arg)
+{
+	TraceRing* ring = s_Ring;
+	if (!ring)
+		ring = s_Ring = CreateRing();
+
+	uint64 head = ring->m_Head.load(std::memory_order_relaxed);
+	Event& event = ring->m_Events[head & (RING_SIZE - 1)];
+	event.m_TimeNS = NowNS();
+	event.m_ID = id;
+	event.m_Name = name;
+	event.m_Arg = arg;
+	event.m_Type = type;
+	ring->m_Head.store(head + 1, std::memory_order_release);
+}
+
+SIZET FiberTrace::GetEventCount()
+{
+	std::lock_guard<std::mutex> lock(s_RingLock);
+	SIZET count = 0;
+	for (TraceRing* ring : s_Rings)
+	{
+		uint64 head = ring->m_Head.load(std::memory_order_acquire);
+		uint64 start = ring->m_Start.load(std::memory_order_relaxed);
+		count += (SIZET)TMIN(head - start, (uint64)RING_SIZE);
+	}
+	return count;
+}
+
+bool FiberTrace::WriteChromeJson(const char* path)
+{
+	// Copy the rings first, an event is only kept when its slot can't have been reused during the copy
+	std::vector<std::vector<Event>> threads;
+	std::vector<const char*> names;
+	{
+		std::lock_guard<std::mutex> lock(s_RingLock);
+		for (TraceRing* ring : s_Rings)
+		{
+			uint64 head = ring->m_Head.load(std::memory_order_acquire);
+			uint64 first = TMAX(ring->m_Start.load(std::memory_order_relaxed), head > RING_SIZE ? head - RING_SIZE : 0);
+			std::vector<Event> events;
+			events.reserve((SIZET)(head - first));
+			for (uint64 i = first; i < head; ++i)
+				events.push_back(ring->m_Events[i & (RING_SIZE - 1)]);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			// The writer of event head may already be in the slot of event head - RING_SIZE
+			uint64 reused = ring->m_Head.load(std::memory_order_relaxed) + 1;
+			if (reused > first + RING_SIZE)
+			{
+				SIZET torn = (SIZET)TMIN(reused - first - RING_SIZE, (uint64)events.size());
+				events.erase(events.begin(), events.begin() + torn);
+			}
+			threads.push_back(std::move(events));
+			names.push_back(ring->m_Name);
+		}
+	}
+
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	uint64 base = ~(uint64)0;
+	for (auto& events : threads)
+		if (!events.empty())
+			base = TMIN(base, events.front().m_TimeNS);
+
+	bool first = true;
+	auto begin = [&](const char* phase, const char* name, uint32 tid, uint64 timeNS) {
+		fprintf(file, "%s\n{\"ph\":\"%s\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"name\":", first ? "" : ",", phase, tid, (timeNS - base) / 1000.0);
+		WriteString(file, name ? name : "Job");
+		first = false;
+	};
+
+	fprintf(file, "{\"traceEvents\":[");
+	for (uint32 tid = 0; tid < (uint32)threads.size(); ++tid)
+	{
+		fprintf(file, "%s\n{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",", tid);
+		WriteString(file, names[tid]);
+		fprintf(file, "}}");
+		first = false;
+
+		// A job runs in slices, from its start or a resume to the next suspend or its end
+		std::unordered_map<uint64, const Event*> running;
+		const Event* park = nullptr;
+		for (const Event& event : threads[tid])
+		{
+			switch (event.m_Type)
+			{
+			case EventType::JOB_POST:
+				begin("s", "Post", tid, event.m_TimeNS);
+				fprintf(file, ",\"cat\":\"job\",\"id\":%llu}", (unsigned long long)event.m_ID);
+				break;
+			case EventType::JOB_START:
+				begin("f", "Post", tid, event.m_TimeNS);
+				fprintf(file, ",\"cat\":\"job\",\"bp\":\"e\",\"id\":%llu}", (unsigned long long)event.m_ID);
+				running[event.m_ID] = &event;
+				break;
+			case EventType::FIBER_RESUME:
+				running[event.m_ID] = &event;
+				break;
+			case EventType::FIBER_SUSPEND:
+			case EventType::JOB_END:
+			{
+				auto it = running.find(event.m_ID);
+				if (it == running.end())
+					break;
+				begin("X", it->second->m_Name, tid, it->second->m_TimeNS);
+				fprintf(file, ",\"cat\":\"job\",\"dur\":%.3f,\"args\":{\"job\":%llu,\"suspended\":%s}}", (event.m_TimeNS - it->second->m_TimeNS) / 1000.0,
+					(unsigned long long)event.m_ID, event.m_Type == EventType::FIBER_SUSPEND ? "true" : "false");
+				running.erase(it);
+				break;
+			}
+			case EventType::WORKER_PARK:
+				park = &event;
+				break;
+			case EventType::WORKER_UNPARK:
+				if (park)
+				{
+					begin("X", "Park", tid, park->m_TimeNS);
+					fprintf(file, ",\"cat\":\"idle\",\"dur\":%.3f}", (event.m_TimeNS - park->m_TimeNS) / 1000.0);
+					park = nullptr;
+				}
+				break;
+			case EventType::JOB_STEAL:
+				begin("i", "Steal", tid, event.m_TimeNS);
+				fprintf(file, ",\"cat\":\"job\",\"s\":\"t\",\"args\":{\"job\":%llu,\"victim\":%u}}", (unsigned long long)event.m_ID, event.m_Arg);
+				break;
+			case EventType::FIBER_SWITCH:
+				begin("i", "Switch", tid, event.m_TimeNS);
+				fprintf(file, ",\"cat\":\"fiber\",\"s\":\"t\"}");
+				break;
+			case EventType::SIGNAL_TRIGGER:
+				begin("i", "Signal", tid, event.m_TimeNS);
+				fprintf(file, ",\"cat\":\"signal\",\"s\":\"t\",\"args\":{\"signal\":%llu,\"result\":%d}}", (unsigned long long)event.m_ID, (int32)event.m_Arg);
+				break;
+			case EventType::USER:
+				begin("i", event.m_Name ? event.m_Name : "User", tid, event.m_TimeNS);
+				fprintf(file, ",\"cat\":\"user\",\"s\":\"t\",\"args\":{\"id\":%llu,\"arg\":%u}}", (unsigned long long)event.m_ID, event.m_Arg);
+				break;
+			}
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+
+FiberTrace::JobNameScope::JobNameScope(const char* name)
+	: m_Previous(s_JobName)
+{
+	s_JobName = name;
+}
+
+FiberTrace::JobNameScope::~JobNameScope()
+{
+	s_JobName = m_Previous;
+}
+
+/*static*/ const char* FiberTrace::JobNameScope::GetCurrent()
+{
+	return s_JobName;
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
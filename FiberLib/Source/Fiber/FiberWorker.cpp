@@ -16,6 +16,11 @@ static void FiberWorkerProc(void* data)
 
 	worker->m_CurrentFiber = fiber;
 	Fiber::SwitchTo(fiber->m_Fiber);
+
+	// The fiber came back here because it left Poll, pooled it would return from Poll once handed out
+	// again, to a worker still starting up as the scheduler shuts down
+	worker->m_Scheduler->DestroyFiber(worker->m_DeferredFiber);
+	worker->m_DeferredFiber = nullptr;
 }
 
 /*explicit*/ FiberWorker::FiberWorker(const char* name, uint32 threadID)
@@ -26,12 +31,133 @@ static void FiberWorkerProc(void* data)
 
 /*virtual*/ FiberWorker::~FiberWorker()
 {
+	delete m_IoRing.load(std::memory_order_relaxed);
+	delete m_Reactor.load(std::memory_order_relaxed);
 }
 
 /*virtual*/ void FiberWorker::Main()
 {
 	m_MainFiber = Fiber::InitFromThread();
+	m_Scheduler->m_PoolResource.BindCurrentThread(m_ThreadID);
 	FiberWorkerProc(nullptr);
+	Fiber::ReleaseFromThread();
+	m_MainFiber = nullptr;
+}
+
+/*static*/ IdlePolicy IdlePolicy::FromPreset(Preset preset)
+{
+	IdlePolicy policy;
+	switch (preset)
+	{
+	case Preset::LOW_LATENCY:
+		policy.m_SpinUS = 200;
+		policy.m_YieldUS = 1000;
+		break;
+	case Preset::BALANCED:
+		break;
+	case Preset::POWER_SAVING:
+		policy.m_SpinUS = 0;
+		policy.m_YieldUS = 0;
+		break;
+	}
+	return policy;
+}
+
+void FiberWorker::Idle(const IdlePolicy& policy, uint64 remainUS)
+{
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point now = Clock::now();
+	if (m_IdleStart == Clock::time_point())
+		m_IdleStart = now;
+	uint64 idleUS = (uint64)std::chrono::duration_cast<std::chrono::microseconds>(now - m_IdleStart).count();
+
+	IdlePhase phase;
+	if (idleUS < policy.m_SpinUS)
+	{
+		phase = IDLE_SPIN;
+		for (uint32 i = 0; i < 64; ++i)
+			CpuPause();
+	}
+	else if (idleUS < (uint64)policy.m_SpinUS + policy.m_YieldUS)
+	{
+		phase = IDLE_YIELD;
+		std::this_thread::yield();
+	}
+	else
+	{
+		// Start over with spinning once woken, new work tends to come in bursts
+		phase = IDLE_PARK;
+		m_Scheduler->ParkWorker(this, remainUS);
+		m_ParkCount.fetch_add(1, std::memory_order_relaxed);
+		ResetIdle();
+	}
+	uint64 spentNS = (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - now).count();
+	m_IdleNS[phase].fetch_add(spentNS, std::memory_order_relaxed);
+}
+
+IdleStats FiberWorker::GetIdleStats() const
+{
+	IdleStats stats;
+	stats.m_SpinNS = m_IdleNS[IDLE_SPIN].load(std::memory_order_relaxed);
+	stats.m_YieldNS = m_IdleNS[IDLE_YIELD].load(std::memory_order_relaxed);
+	stats.m_ParkNS = m_IdleNS[IDLE_PARK].load(std::memory_order_relaxed);
+	stats.m_ParkCount = m_ParkCount.load(std::memory_order_relaxed);
+	return stats;
+}
+
+IoRing* FiberWorker::GetIoRing(bool create)
+{
+	IoRing* ring = m_IoRing.load(std::memory_order_acquire);
+	if (!ring && create)
+	{
+		ASSERT(GetCurrentThreadWorker() == this);
+		// A ring that fails to set up is kept too, so the calls fall back to blocking right away.
+		// Without a reactor to wait in, a parked worker would miss the completions.
+		ring = new IoRing();
+		Reactor* reactor = GetReactor();
+		if (reactor->IsValid() && ring->Init())
+			reactor->WatchRing(ring->GetFd());
+		m_IoRing.store(ring, std::memory_order_release);
+	}
+	return ring;
+}
+
+Reactor* FiberWorker::GetReactor(bool create)
+{
+	Reactor* reactor = m_Reactor.load(std::memory_order_acquire);
+	if (!reactor && create)
+	{
+		ASSERT(GetCurrentThreadWorker() == this);
+		reactor = new Reactor();
+		reactor->Init();
+		m_Reactor.store(reactor, std::memory_order_release);
+	}
+	return reactor;
+}
+
+/*virtual*/ void FiberWorker::WaitForWakeUp(uint64 timeUS)
+{
+	IoRing* ring = m_IoRing.load(std::memory_order_relaxed);
+	Reactor* reactor = m_Reactor.load(std::memory_order_relaxed);
+	if (!reactor || !reactor->IsValid() || (!reactor->IsBusy() && !(ring && ring->IsBusy())))
+	{
+		ThreadWorker::WaitForWakeUp(timeUS);
+		return;
+	}
+
+	// Either a waker sees the flag and signals the reactor, or we see it has already run
+	m_IoWaiting.store(true, std::memory_order_seq_cst);
+	if (m_ParkState.load(std::memory_order_seq_cst) == PARK_PARKED)
+		reactor->Wait(timeUS);
+	m_IoWaiting.store(false, std::memory_order_relaxed);
+}
+
+/*virtual*/ void FiberWorker::SignalWakeUp()
+{
+	if (m_IoWaiting.load(std::memory_order_seq_cst))
+		m_Reactor.load(std::memory_order_acquire)->Interrupt();
+	else
+		ThreadWorker::SignalWakeUp();
 }
 
 /*static*/ FiberWorker* FiberWorker::GetCurrentThreadWorker()
@@ -0,0 +1,137 @@
+// JobEpoch.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/JobEpoch.h"
+#include "Fiber/FiberWorker.h"
+
+
+EpochArena::~EpochArena()
+{
+	while (Chunk* chunk = m_Chunks)
+	{
+		m_Chunks = chunk->m_Next;
+		::operator delete(chunk);
+	}
+}
+
+void* EpochArena::Allocate(SIZET size, SIZET alignment)
+{
+	UINTPTR aligned = ((UINTPTR)m_Cursor + alignment - 1) & ~(UINTPTR)(alignment - 1);
+	if (!m_Cursor || aligned + size > (UINTPTR)m_End)
+	{
+		// The next kept chunk when it is big enough, a new one in front of it otherwise
+		Chunk* next = m_Current ? m_Current->m_Next : nullptr;
+		if (!next || next->m_Size < size + alignment)
+		{
+			SIZET chunkSize = TMAX(CHUNK_SIZE, size + alignment);
+			Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + chunkSize));
+			chunk->m_Size = chunkSize;
+			chunk->m_Next = next;
+			if (m_Current)
+				m_Current->m_Next = chunk;
+			else
+				m_Chunks = chunk;
+			m_Reserved += chunkSize;
+			next = chunk;
+		}
+		m_Current = next;
+		m_Cursor = reinterpret_cast<uint8*>(next + 1);
+		m_End = m_Cursor + next->m_Size;
+		aligned = ((UINTPTR)m_Cursor + alignment - 1) & ~(UINTPTR)(alignment - 1);
+	}
+	m_Cursor = reinterpret_cast<uint8*>(aligned + size);
+	return reinterpret_cast<void*>(aligned);
+}
+
+void EpochArena::Reset()
+{
+	m_Current = m_Chunks;
+	m_Cursor = m_Chunks ? reinterpret_cast<uint8*>(m_Chunks + 1) : nullptr;
+	m_End = m_Chunks ? m_Cursor + m_Chunks->m_Size : nullptr;
+}
+
+
+JobEpoch::JobEpoch(FiberScheduler* scheduler)
+	: m_Scheduler(scheduler)
+	, m_Pending(0)
+{
+}
+
+void* JobEpoch::Allocate(SIZET size, SIZET alignment)
+{
+	FiberWorker* worker = FiberWorker::GetCurrentThreadWorker();
+	if (worker && worker->m_Scheduler == m_Scheduler)
+		return m_Arenas[worker->GetThreadID()].Allocate(size, alignment);
+	std::lock_guard<std::mutex> lock(m_SharedLock);
+	return m_SharedArena.Allocate(size, alignment);
+}
+
+SIZET JobEpoch::GetReserved() const
+{
+	SIZET reserved = m_SharedArena.GetReserved();
+	for (const EpochArena& arena : m_Arenas)
+		reserved += arena.GetReserved();
+	return reserved;
+}
+
+void JobEpoch::Begin()
+{
+	m_Pending.store(1, std::memory_order_relaxed);
+	m_Done = m_Scheduler->FetchSignal();
+	m_Done->Arm();
+}
+
+JobSignalPtr JobEpoch::End()
+{
+	// The epoch may be recycled as soon as the scope lets go of it
+	JobSignalPtr done = m_Done;
+	Release();
+	return done;
+}
+
+void JobEpoch::Release()
+{
+	if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	// Every job of the epoch has run, nothing points into the arenas any more
+	for (EpochArena& arena : m_Arenas)
+		arena.Reset();
+	m_SharedArena.Reset();
+	JobSignalPtr done = std::move(m_Done);
+	{
+		std::lock_guard<std::mutex> lock(m_Scheduler->m_Lock);
+		m_Scheduler->m_FreeEpochs.push_back(this);
+	}
+	done->Trigger(0);
+}
+
+
+JobSignalPtr EpochScope::End()
+{
+	if (!m_Epoch)
+		return JobSignalPtr();
+	return std::exchange(m_Epoch, nullptr)->End();
+}
+
+
+EpochScope FiberScheduler::BeginEpoch()
+{
+	JobEpoch* epoch = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		if (!m_FreeEpochs.empty())
+		{
+			epoch = m_FreeEpochs.back();
+			m_FreeEpochs.pop_back();
+		}
+	}
+	if (!epoch)
+		epoch = new JobEpoch(this);
+	epoch->Begin();
+	return EpochScope(epoch);
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,87 @@
+// JobPool.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/JobPool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+JobPool::JobPool()
+	: m_FreeHead(0)
+	, m_Count(0)
+{
+	for (auto& chunk : m_Chunks)
+		chunk = nullptr;
+}
+
+JobPool::~JobPool()
+{
+	for (auto& chunk : m_Chunks)
+		delete[] chunk.load();
+}
+
+JobRecord* JobPool::Allocate()
+{
+	uint64 head = m_FreeHead.load(std::memory_order_acquire);
+	while ((uint32)head != 0)
+	{
+		// The tag in the upper half makes a concurrent pop and push of the same index fail the exchange
+		JobRecord* record = Resolve((uint32)head - 1);
+		uint64 next = (((head >> 32) + 1) << 32) | record->m_NextFree.load(std::memory_order_relaxed);
+		if (m_FreeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+			return record;
+	}
+
+	uint32 index = m_Count.fetch_add(1, std::memory_order_relaxed);
+	if (index >= CHUNK_SIZE * MAX_CHUNKS)
+	{
+		fprintf(stderr, "JobPool: more than %u jobs and signals alive\n", CHUNK_SIZE * MAX_CHUNKS);
+		abort();
+	}
+
+	uint32 chunk = index / CHUNK_SIZE;
+	JobRecord* records = m_Chunks[chunk].load(std::memory_order_acquire);
+	if (!records)
+		records = AllocateChunk(chunk);
+	return records + index % CHUNK_SIZE;
+}
+
+void JobPool::Free(JobRecord* record)
+{
+	ASSERT(record->m_Holds == 0);
+	record->m_Generation++;
+	record->m_Job.Reset();
+	record->m_Signal.Reset();
+
+	uint64 head = m_FreeHead.load(std::memory_order_relaxed);
+	uint64 next;
+	do
+	{
+		record->m_NextFree.store((uint32)head, std::memory_order_relaxed);
+		next = (((head >> 32) + 1) << 32) | (record->m_Index + 1);
+	} while (!m_FreeHead.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+JobRecord* JobPool::AllocateChunk(uint32 chunk)
+{
+	std::lock_guard<std::mutex> lock(m_ChunkLock);
+	JobRecord* records = m_Chunks[chunk].load(std::memory_order_relaxed);
+	if (records)
+		return records;
+
+	records = new JobRecord[CHUNK_SIZE];
+	for (uint32 i = 0; i < CHUNK_SIZE; ++i)
+	{
+		JobRecord& record = records[i];
+		record.m_Index = chunk * CHUNK_SIZE + i;
+		record.m_Pool = this;
+		record.m_Job.m_Record = &record;
+		record.m_Signal.m_Record = &record;
+	}
+	m_Chunks[chunk].store(records, std::memory_order_release);
+	return records;
+}
+
+//------------------------------------------------------------------------------
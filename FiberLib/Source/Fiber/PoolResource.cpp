@@ -0,0 +1,165 @@
+// PoolResource.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/PoolResource.h"
+#include <new>
+
+// Static
+//------------------------------------------------------------------------------
+// Blocks start past the span header, on their own cache line
+static constexpr SIZET SPAN_HEADER = 64;
+
+static THREAD_LOCAL const PoolResource* s_BoundResource = nullptr;
+static THREAD_LOCAL void*               s_BoundCache = nullptr;
+
+// Block size of every class, and the smallest class by size in BLOCK_ALIGN steps
+struct SizeClassTable
+{
+	uint32 m_Size[PoolResource::CLASS_COUNT]{};
+	uint8  m_Class[PoolResource::MAX_BLOCK_SIZE / PoolResource::BLOCK_ALIGN + 1]{};
+
+	constexpr SizeClassTable()
+	{
+		for (uint32 i = 0; i < PoolResource::CLASS_COUNT; ++i)
+		{
+			if (i < 4)
+				m_Size[i] = 16 * (i + 1);
+			else
+			{
+				uint32 base = 64 << ((i - 4) / 4);
+				m_Size[i] = base + base / 4 * ((i - 4) % 4 + 1);
+			}
+		}
+		uint32 sizeClass = 0;
+		for (uint32 i = 0; i < sizeof(m_Class); ++i)
+		{
+			while (m_Size[sizeClass] < i * PoolResource::BLOCK_ALIGN)
+				++sizeClass;
+			m_Class[i] = (uint8)sizeClass;
+		}
+	}
+};
+static constexpr SizeClassTable s_SizeClasses;
+
+
+PoolResource::PoolResource(std::pmr::memory_resource* upstream)
+	: m_Upstream(upstream)
+	, m_SpanCount(0)
+{
+	for (auto& cache : m_Caches)
+		cache = nullptr;
+}
+
+PoolResource::~PoolResource()
+{
+	auto release = [](Cache* cache) {
+		while (Span* span = cache->m_Spans)
+		{
+			cache->m_Spans = span->m_Next;
+			::operator delete(span, std::align_val_t(SPAN_SIZE));
+		}
+	};
+	for (auto& cache : m_Caches)
+	{
+		if (Cache* owned = cache.load(std::memory_order_relaxed))
+		{
+			release(owned);
+			delete owned;
+		}
+	}
+	release(&m_Shared);
+}
+
+void PoolResource::BindCurrentThread(uint32 index)
+{
+	ASSERT(index < THREAD_COUNT_MAX);
+	Cache* cache = m_Caches[index].load(std::memory_order_acquire);
+	if (!cache)
+	{
+		cache = new Cache();
+		m_Caches[index].store(cache, std::memory_order_release);
+	}
+	s_BoundResource = this;
+	s_BoundCache = cache;
+}
+
+/*virtual*/ void* PoolResource::do_allocate(SIZET bytes, SIZET alignment)
+{
+	if (bytes > MAX_BLOCK_SIZE || alignment > BLOCK_ALIGN)
+		return m_Upstream->allocate(bytes, alignment);
+
+	uint32 sizeClass = s_SizeClasses.m_Class[(bytes + BLOCK_ALIGN - 1) / BLOCK_ALIGN];
+	if (Cache* cache = GetThreadCache())
+		return Allocate(cache, sizeClass);
+	std::lock_guard<std::mutex> lock(m_SharedLock);
+	return Allocate(&m_Shared, sizeClass);
+}
+
+/*virtual*/ void PoolResource::do_deallocate(void* ptr, SIZET bytes, SIZET alignment)
+{
+	if (bytes > MAX_BLOCK_SIZE || alignment > BLOCK_ALIGN)
+	{
+		m_Upstream->deallocate(ptr, bytes, alignment);
+		return;
+	}
+
+	Span* span = reinterpret_cast<Span*>((UINTPTR)ptr & ~(UINTPTR)(SPAN_SIZE - 1));
+	Cache* owner = span->m_Owner;
+	Block* block = static_cast<Block*>(ptr);
+	if (owner == GetThreadCache())
+	{
+		block->m_Next = owner->m_Free[span->m_Class];
+		owner->m_Free[span->m_Class] = block;
+		return;
+	}
+
+	// Freed on another thread, the owner takes the whole list over once its own runs dry
+	std::atomic<Block*>& remote = owner->m_Remote[span->m_Class];
+	Block* head = remote.load(std::memory_order_relaxed);
+	do
+	{
+		block->m_Next = head;
+	} while (!remote.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+PoolResource::Cache* PoolResource::GetThreadCache() const
+{
+	return s_BoundResource == this ? static_cast<Cache*>(s_BoundCache) : nullptr;
+}
+
+void* PoolResource::Allocate(Cache* cache, uint32 sizeClass)
+{
+	Block* block = cache->m_Free[sizeClass];
+	if (!block)
+	{
+		// Only the owner empties the remote list, and always all of it, so a pushed block can't come back under us
+		block = cache->m_Remote[sizeClass].exchange(nullptr, std::memory_order_acquire);
+		if (!block)
+			return Carve(cache, sizeClass);
+	}
+	cache->m_Free[sizeClass] = block->m_Next;
+	return block;
+}
+
+void* PoolResource::Carve(Cache* cache, uint32 sizeClass)
+{
+	uint32 size = s_SizeClasses.m_Size[sizeClass];
+	if (!cache->m_Carve[sizeClass] || cache->m_Carve[sizeClass] + size > cache->m_CarveEnd[sizeClass])
+	{
+		Span* span = static_cast<Span*>(::operator new(SPAN_SIZE, std::align_val_t(SPAN_SIZE)));
+		span->m_Owner = cache;
+		span->m_Class = sizeClass;
+		span->m_Next = cache->m_Spans;
+		cache->m_Spans = span;
+		cache->m_Carve[sizeClass] = reinterpret_cast<uint8*>(span) + SPAN_HEADER;
+		cache->m_CarveEnd[sizeClass] = reinterpret_cast<uint8*>(span) + SPAN_SIZE;
+		m_SpanCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	void* block = cache->m_Carve[sizeClass];
+	cache->m_Carve[sizeClass] += size;
+	return block;
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
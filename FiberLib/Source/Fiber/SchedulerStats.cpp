@@ -0,0 +1,125 @@
+// SchedulerStats.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/SchedulerStats.h"
+
+
+/*static*/ uint32 LatencyHistogram::GetBucket(uint64 ns)
+{
+	// The exponent above the sub bucket bits picks the power of two, the top bits below it the sub bucket
+	ns = TMIN(ns, MAX_NS);
+	uint32 msb = 63 - (uint32)CountLeadingZeros64(ns | 1);
+	uint32 exponent = msb > SUB_BITS ? msb - SUB_BITS : 0;
+	return exponent * SUB_COUNT + (uint32)(ns >> exponent);
+}
+
+/*static*/ uint64 LatencyHistogram::GetBucketLow(uint32 bucket)
+{
+	if (bucket < 2 * SUB_COUNT)
+		return bucket;
+	uint32 exponent = bucket / SUB_COUNT - 1;
+	return (uint64)(bucket % SUB_COUNT + SUB_COUNT) << exponent;
+}
+
+void LatencyHistogram::Add(uint64 ns)
+{
+	++m_Counts[GetBucket(ns)];
+	++m_Count;
+	m_SumNS += ns;
+	m_MaxNS = TMAX(m_MaxNS, ns);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other)
+{
+	for (uint32 i = 0; i < BUCKET_COUNT; ++i)
+		m_Counts[i] += other.m_Counts[i];
+	m_Count += other.m_Count;
+	m_SumNS += other.m_SumNS;
+	m_MaxNS = TMAX(m_MaxNS, other.m_MaxNS);
+}
+
+uint64 LatencyHistogram::GetPercentile(double fraction) const
+{
+	if (!m_Count)
+		return 0;
+	uint64 rank = (uint64)(fraction * (double)m_Count);
+	rank = rank ? TMIN(rank, m_Count) : 1;
+	uint64 seen = 0;
+	for (uint32 i = 0; i < BUCKET_COUNT; ++i)
+	{
+		seen += m_Counts[i];
+		if (seen >= rank)
+		{
+			uint64 low = GetBucketLow(i);
+			uint64 high = i + 1 < BUCKET_COUNT ? GetBucketLow(i + 1) : low + 1;
+			return TMIN(low + (high - low) / 2, m_MaxNS);
+		}
+	}
+	return m_MaxNS;
+}
+
+
+void WorkerStats::Merge(const WorkerStats& other)
+{
+	m_JobsExecuted += other.m_JobsExecuted;
+	m_FibersCreated += other.m_FibersCreated;
+	m_FibersReused += other.m_FibersReused;
+	m_ContextSwitches += other.m_ContextSwitches;
+	m_Steals += other.m_Steals;
+	m_IdleNS += other.m_IdleNS;
+	m_ParkNS += other.m_ParkNS;
+	m_ParkCount += other.m_ParkCount;
+}
+
+
+void WorkerMetrics::Histogram::Add(uint64 ns)
+{
+	WorkerMetrics::Add(m_Counts[LatencyHistogram::GetBucket(ns)], 1);
+	WorkerMetrics::Add(m_Count, 1);
+	WorkerMetrics::Add(m_SumNS, ns);
+	if (ns > m_MaxNS.load(std::memory_order_relaxed))
+		m_MaxNS.store(ns, std::memory_order_relaxed);
+}
+
+void WorkerMetrics::Histogram::CopyTo(LatencyHistogram& histogram) const
+{
+	// The buckets are read while the worker adds to them, the count is summed from them to stay consistent
+	uint64 count = 0;
+	for (uint32 i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+	{
+		uint64 value = m_Counts[i].load(std::memory_order_relaxed);
+		histogram.m_Counts[i] += value;
+		count += value;
+	}
+	histogram.m_Count += count;
+	histogram.m_SumNS += m_SumNS.load(std::memory_order_relaxed);
+	histogram.m_MaxNS = TMAX(histogram.m_MaxNS, m_MaxNS.load(std::memory_order_relaxed));
+}
+
+void WorkerMetrics::AddQueueLatency(uint8 prio, uint64 ns)
+{
+	m_QueueLatency[prio].Add(ns);
+}
+
+void WorkerMetrics::AddRunTime(uint8 prio, uint64 ns)
+{
+	m_RunTime[prio].Add(ns);
+}
+
+void WorkerMetrics::CopyTo(WorkerStats& stats, SchedulerStats& histograms) const
+{
+	stats.m_JobsExecuted = m_JobsExecuted.load(std::memory_order_relaxed);
+	stats.m_FibersCreated = m_FibersCreated.load(std::memory_order_relaxed);
+	stats.m_FibersReused = m_FibersReused.load(std::memory_order_relaxed);
+	stats.m_ContextSwitches = m_ContextSwitches.load(std::memory_order_relaxed);
+	stats.m_Steals = m_Steals.load(std::memory_order_relaxed);
+	for (int32 prio = 0; prio < (int32)Job::Priority::PRIO_MAX; ++prio)
+	{
+		m_QueueLatency[prio].CopyTo(histograms.m_QueueLatency[prio]);
+		m_RunTime[prio].CopyTo(histograms.m_RunTime[prio]);
+	}
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
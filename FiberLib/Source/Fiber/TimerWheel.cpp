@@ -0,0 +1,169 @@
+// TimerWheel.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Fiber/TimerWheel.h"
+
+
+TimerWheel::TimerWheel()
+	: m_ElapsedUS(Now())
+	, m_DueHead(nullptr)
+	, m_DueTail(nullptr)
+	, m_Overflow(nullptr)
+	, m_Inbox(nullptr)
+{
+	for (auto& level : m_Slots)
+	{
+		for (auto& slot : level)
+			slot = nullptr;
+	}
+	for (auto& occupied : m_Occupied)
+		occupied = 0;
+}
+
+void TimerWheel::Insert(TimerNode* node)
+{
+	uint64 deadline = node->m_DeadlineUS;
+	if (deadline <= m_ElapsedUS)
+	{
+		PushDue(node);
+		return;
+	}
+
+	// The highest digit where the deadline and the wheel time differ picks the level
+	uint64 masked = (m_ElapsedUS ^ deadline) | (SLOT_COUNT - 1);
+	uint32 level = (uint32)(63 - CountLeadingZeros64(masked)) / SLOT_BITS;
+	if (level >= LEVEL_COUNT)
+	{
+		node->m_Next = m_Overflow;
+		m_Overflow = node;
+		return;
+	}
+
+	uint32 slot = (uint32)(deadline >> (level * SLOT_BITS)) & (SLOT_COUNT - 1);
+	node->m_Next = m_Slots[level][slot];
+	m_Slots[level][slot] = node;
+	m_Occupied[level] |= (uint64)1 << slot;
+}
+
+void TimerWheel::Post(TimerNode* node)
+{
+	TimerNode* head = m_Inbox.load(std::memory_order_relaxed);
+	do
+	{
+		node->m_Next = head;
+	} while (!m_Inbox.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+TimerNode* TimerWheel::Advance(uint64 nowUS)
+{
+	DrainInbox();
+
+	uint32 level = 0;
+	uint32 slot = 0;
+	uint64 deadline = 0;
+	while (NextExpiration(level, slot, deadline) && deadline <= nowUS)
+	{
+		// Timers of the slot now share every higher digit with the wheel time, so they move down
+		m_ElapsedUS = deadline;
+		TimerNode* node = nullptr;
+		if (level == LEVEL_COUNT)
+		{
+			node = m_Overflow;
+			m_Overflow = nullptr;
+		}
+		else
+		{
+			node = m_Slots[level][slot];
+			m_Slots[level][slot] = nullptr;
+			m_Occupied[level] &= ~((uint64)1 << slot);
+		}
+		while (node)
+		{
+			TimerNode* next = node->m_Next;
+			Insert(node);
+			node = next;
+		}
+	}
+	if (nowUS > m_ElapsedUS)
+		m_ElapsedUS = nowUS;
+
+	TimerNode* due = m_DueHead;
+	m_DueHead = nullptr;
+	m_DueTail = nullptr;
+	return due;
+}
+
+uint64 TimerWheel::GetRemainTime(uint64 nowUS) const
+{
+	if (m_DueHead)
+		return 0;
+
+	uint32 level = 0;
+	uint32 slot = 0;
+	uint64 deadline = 0;
+	if (!NextExpiration(level, slot, deadline))
+		return ~(uint64)0;
+	return deadline > nowUS ? deadline - nowUS : 0;
+}
+
+/*static*/ uint64 TimerWheel::Now()
+{
+	return (uint64)std::chrono::duration_cast<TimerUS>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*static*/ uint64 TimerWheel::NowNS()
+{
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool TimerWheel::NextExpiration(uint32& level, uint32& slot, uint64& deadlineUS) const
+{
+	// Lower levels only hold timers due before the next slot of any higher level
+	for (level = 0; level < LEVEL_COUNT; ++level)
+	{
+		if (!m_Occupied[level])
+			continue;
+
+		uint32 shift = level * SLOT_BITS;
+		uint64 levelRange = (uint64)1 << (shift + SLOT_BITS);
+		DebugRun(uint32 current = (uint32)(m_ElapsedUS >> shift) & (SLOT_COUNT - 1));
+		ASSERT((m_Occupied[level] & ~(~(uint64)0 << current)) == 0);
+		slot = (uint32)CountTrailingZeros64(m_Occupied[level]);
+		deadlineUS = (m_ElapsedUS & ~(levelRange - 1)) + ((uint64)slot << shift);
+		return true;
+	}
+
+	// Timers beyond the top level are looked at again when it wraps around
+	if (m_Overflow)
+	{
+		slot = 0;
+		deadlineUS = (m_ElapsedUS | MAX_DELAY_US) + 1;
+		return true;
+	}
+	return false;
+}
+
+void TimerWheel::PushDue(TimerNode* node)
+{
+	node->m_Next = nullptr;
+	if (m_DueTail)
+		m_DueTail->m_Next = node;
+	else
+		m_DueHead = node;
+	m_DueTail = node;
+}
+
+void TimerWheel::DrainInbox()
+{
+	TimerNode* node = m_Inbox.exchange(nullptr, std::memory_order_acquire);
+	while (node)
+	{
+		TimerNode* next = node->m_Next;
+		Insert(node);
+		node = next;
+	}
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
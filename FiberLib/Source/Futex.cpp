@@ -0,0 +1,69 @@
+// Futex.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Futex.h"
+#include "Misc.h"
+
+#if defined(__WINDOWS__)
+	#include <windows.h>
+	#pragma comment(lib, "Synchronization.lib")
+#elif defined(__LINUX__)
+	#include <limits.h>
+	#include <time.h>
+	#include <unistd.h>
+	#include <sys/syscall.h>
+	#include <linux/futex.h>
+#else
+	#include <chrono>
+	#include <thread>
+#endif
+
+
+namespace Futex
+{
+#if defined(__WINDOWS__)
+	void Wait(std::atomic<uint32>& word, uint32 expected, uint64 timeUS)
+	{
+		// Round up, a timed wait must not turn into a busy loop
+		uint64 timeMS = (timeUS + 999) / 1000;
+		::WaitOnAddress(&word, &expected, sizeof(uint32), timeUS == 0 || timeMS >= INFINITE ? INFINITE : (DWORD)timeMS);
+	}
+
+	void Wake(std::atomic<uint32>& word, uint32 count)
+	{
+		if (count == 1)
+			::WakeByAddressSingle(&word);
+		else
+			::WakeByAddressAll(&word);
+	}
+#elif defined(__LINUX__)
+	void Wait(std::atomic<uint32>& word, uint32 expected, uint64 timeUS)
+	{
+		struct timespec timeout;
+		timeout.tv_sec = (time_t)(timeUS / 1000000);
+		timeout.tv_nsec = (long)(timeUS % 1000000) * 1000;
+		syscall(SYS_futex, reinterpret_cast<uint32*>(&word), FUTEX_WAIT_PRIVATE, expected, timeUS == 0 ? nullptr : &timeout, nullptr, 0);
+	}
+
+	void Wake(std::atomic<uint32>& word, uint32 count)
+	{
+		syscall(SYS_futex, reinterpret_cast<uint32*>(&word), FUTEX_WAKE_PRIVATE, count > INT_MAX ? INT_MAX : (int)count, nullptr, nullptr, 0);
+	}
+#else
+	void Wait(std::atomic<uint32>& word, uint32 expected, uint64 timeUS)
+	{
+		// No address wait here, poll the word at a coarse interval
+		uint64 sleepUS = timeUS == 0 || timeUS > 1000 ? 1000 : timeUS;
+		if (word.load(std::memory_order_acquire) == expected)
+			std::this_thread::sleep_for(std::chrono::microseconds(sleepUS));
+	}
+
+	void Wake(std::atomic<uint32>& word, uint32 count)
+	{
+	}
+#endif
+}
+
+//------------------------------------------------------------------------------
\ No newline at end of file
@@ -14,6 +14,9 @@ Job::Job()
 	: m_Status(Status::STATUS_CREATED)
 	, m_Aborted(false)
 	, m_Prio(Priority::PRIO_TOP)
+	, m_StackSize(StackSize::STACK_DEFAULT)
+	, m_MaxPeriod(0)
+	, m_Name(nullptr)
 {}
 
 // Destructor
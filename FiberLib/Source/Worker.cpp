@@ -6,9 +6,14 @@
 #include <assert.h>
 #include <chrono>
 #include "Worker.h"
+#include "CpuTopology.h"
+#include "Futex.h"
 
 #if defined(__WINDOWS__)
 	#include <windows.h>
+#elif defined(__LINUX__)
+	#include <pthread.h>
+	#include <sched.h>
 #endif
 
 // Static
@@ -21,16 +26,18 @@ static THREAD_LOCAL ThreadWorker* s_Worker;
 	: m_ThreadID(threadID)
 	, m_ThreadFilterID((uint64)1 << threadID)
 	, m_ThreadName(name)
+	, m_ParkState(PARK_RUNNING)
 	, m_Stopped(false)
 	, m_Exited(false)
 {	
 	ASSERT(m_ThreadID < 64);
-	SetAffinityMask(m_ThreadFilterID);
 }
 /*virtual*/ ThreadWorker::~ThreadWorker()
 {
 	while (!m_Exited) 
 		std::this_thread::sleep_for(std::chrono::seconds(1));
+	if (m_Thread.joinable())
+		m_Thread.join();
 }
 
 void ThreadWorker::Init()
@@ -38,21 +45,83 @@ void ThreadWorker::Init()
 	m_Thread = std::thread([this]() { ThreadWrapperFunc(this); });
 }
 
-void ThreadWorker::SetAffinityMask(uint64 mask)
+bool ThreadWorker::SetAffinity(const std::vector<uint32>& cpus)
 {
+	m_Affinity = cpus;
+	return ApplyAffinity();
+}
+
+bool ThreadWorker::SetAffinityMask(uint64 mask)
+{
+	std::vector<uint32> cpus;
+	for (; mask; mask &= mask - 1)
+		cpus.push_back((uint32)CountTrailingZeros64(mask));
+	return SetAffinity(cpus);
+}
+
+bool ThreadWorker::ApplyAffinity()
+{
+	// Not started yet, the thread applies it itself before running anything
+	bool self = s_Worker == this;
+	if (!self && !m_Thread.joinable())
+		return true;
+
+	// Unpinning goes back to every CPU the process may use
+	const std::vector<uint32>* cpus = &m_Affinity;
+	std::vector<uint32> all;
+	if (m_Affinity.empty())
+	{
+		for (const CpuTopology::CpuInfo& info : CpuTopology::Get().GetCpus())
+			all.push_back(info.m_Cpu);
+		cpus = &all;
+	}
+
 #if defined(__WINDOWS__)
-	::SetThreadAffinityMask((HANDLE)m_Thread.native_handle(), mask);
+	DWORD_PTR mask = 0;
+	for (uint32 cpu : *cpus)
+		if (cpu < 64)
+			mask |= (DWORD_PTR)1 << cpu;
+	HANDLE thread = self ? ::GetCurrentThread() : (HANDLE)m_Thread.native_handle();
+	return mask && ::SetThreadAffinityMask(thread, mask) != 0;
+#elif defined(__LINUX__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (uint32 cpu : *cpus)
+		if (cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &set);
+	pthread_t thread = self ? pthread_self() : m_Thread.native_handle();
+	return CPU_COUNT(&set) && pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+#else
+	return false;
 #endif
 }
 
-void ThreadWorker::Sleep(std::unique_lock<std::mutex>& lock, uint32 timeMS)
+void ThreadWorker::PrepareToPark()
 {
-	m_CV.wait_for(lock, std::chrono::milliseconds(timeMS));
+	m_ParkState.store(PARK_PARKED, std::memory_order_seq_cst);
+}
+
+void ThreadWorker::Park(uint64 timeUS)
+{
+	if (m_ParkState.load(std::memory_order_acquire) == PARK_PARKED)
+		WaitForWakeUp(timeUS);
+	m_ParkState.store(PARK_RUNNING, std::memory_order_relaxed);
 }
 
 void ThreadWorker::WakeUp()
 {
-	m_CV.notify_all();
+	if (m_ParkState.exchange(PARK_RUNNING, std::memory_order_seq_cst) == PARK_PARKED)
+		SignalWakeUp();
+}
+
+/*virtual*/ void ThreadWorker::WaitForWakeUp(uint64 timeUS)
+{
+	Futex::Wait(m_ParkState, PARK_PARKED, timeUS);
+}
+
+/*virtual*/ void ThreadWorker::SignalWakeUp()
+{
+	Futex::Wake(m_ParkState);
 }
 
 /*static*/ uint32 ThreadWorker::GetCurrentThreadID()
@@ -75,6 +144,9 @@ void ThreadWorker::WakeUp()
 	ThreadWorker* wt = reinterpret_cast<ThreadWorker*>(param);
 	s_WorkerThreadID = wt->m_ThreadID;
 	s_Worker = wt;
+	// Pinned before Main, so the worker's first allocations and stack pages land on its own CPUs
+	if (!wt->m_Affinity.empty())
+		wt->ApplyAffinity();
 	wt->Main();
 	wt->m_Exited = true;
 	return 0;
@@ -1,9 +1,37 @@
 // main.cpp
 //------------------------------------------------------------------------------
 #include "Fiber/FiberScheduler.h"
+#include "CpuTopology.h"
+#if defined(__cpp_impl_coroutine)
+	#include "Fiber/FiberTask.h"
+#endif
+#include "Fiber/FiberChannel.h"
+#include "Fiber/FiberIO.h"
+#include "Fiber/FiberSync.h"
+#include "Fiber/FiberTrace.h"
+#include "Fiber/JobEpoch.h"
 #include "Semaphore.h"
 #include <assert.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <thread>
 #include <iostream>
+#if defined(__LINUX__)
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <netinet/in.h>
+	#include <sched.h>
+	#include <sys/socket.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
 
 
 static int32              counter(0);
@@ -139,6 +167,1270 @@ void TestCase3(FiberScheduler* sche)
 	ASSERT(counter == 100000);
 }
 
+void TestCase4(FiberScheduler* sche)
+{
+	// jobs posted from a worker are stolen by the others, pinned jobs stay on their worker
+	threadsafe_counter = 0;
+	std::atomic<int32> pinned(0);
+	auto signal = sche->FetchSignal();
+	for (int32 idx = 0; idx < 1000; ++idx)
+	{
+		auto job = sche->PostJob([]() { TaskAddCounterTS(1); });
+		sche->AddPreCondition(signal, job->GetSignal());
+	}
+	for (int32 idx = 0; idx < 100; ++idx)
+	{
+		auto job = sche->PostJob([&]() {
+			ASSERT(ThreadWorker::GetCurrentThreadID() == E_WORKER_MAIN);
+			pinned++;
+		}, ThreadWorkerFilter::E_WORKER_ON_MAIN);
+		sche->AddPreCondition(signal, job->GetSignal());
+	}
+	sche->YieldFor(signal);
+	ASSERT(threadsafe_counter == 1000);
+	ASSERT(pinned == 100);
+}
+
+void TestCase5(FiberScheduler* sche)
+{
+	// pinned jobs run by priority, whatever filter they were posted with
+	std::atomic<bool> started(false);
+	std::atomic<bool> release(false);
+	std::vector<int32> order;
+	sche->PostJob([&]() {
+		started = true;
+		while (!release) std::this_thread::yield();
+	}, ThreadWorkerFilter::E_WORKER_ON_MAIN);
+	while (!started) std::this_thread::yield();
+
+	auto signal = sche->FetchSignal();
+	const Job::Priority prios[] = { Job::Priority::PRIO_LOW, Job::Priority::PRIO_IO, Job::Priority::PRIO_TOP, Job::Priority::PRIO_COMPUTE };
+	const uint64 filters[] = { ThreadWorkerFilter::E_WORKER_ON_MAIN, ThreadWorkerFilter::E_WORKER_ON_MAIN | ((uint64)1 << 63) };
+	for (auto filter : filters)
+	{
+		for (auto prio : prios)
+		{
+			std::shared_ptr<Job> job = std::make_shared<FuncJob>([&order, prio]() { order.push_back((int32)prio); });
+			job->SetPriority(prio);
+			auto fiberJob = sche->PostJob(job, filter);
+			sche->AddPreCondition(signal, fiberJob->GetSignal());
+		}
+	}
+	release = true;
+	sche->YieldFor(signal);
+	ASSERT(order.size() == 8);
+	ASSERT(std::is_sorted(order.begin(), order.end()));
+
+	// more filters than slots one after another, each taking the slot of one that ran empty
+	int32 ran = 0;
+	for (uint64 i = 1; i <= 100; ++i)
+	{
+		auto job = sche->PostJob([&ran]() { ran++; }, ThreadWorkerFilter::E_WORKER_ON_MAIN | (i << 16));
+		sche->YieldFor(job->GetSignal());
+	}
+	ASSERT(ran == 100);
+}
+
+int32 DeepRecursion(int32 depth)
+{
+	volatile char frame[1024];
+	frame[0] = (char)depth;
+	return depth == 0 ? 0 : DeepRecursion(depth - 1) + frame[0] - frame[0] + 1;
+}
+
+void TestCase6(FiberScheduler* sche)
+{
+	// a job asking for a large stack is handed to a large fiber, idle stacks can be given back
+	std::atomic<int32> result(0);
+	std::shared_ptr<Job> job = std::make_shared<FuncJob>([&result]() { result = DeepRecursion(256); });
+	job->SetStackSize(Job::StackSize::STACK_LARGE);
+	auto fiberJob = sche->PostJob(job);
+	sche->YieldFor(fiberJob->GetSignal());
+	ASSERT(result == 256);
+
+	// an explicit small stack is honoured even across a suspension, jobs left to the default get the scheduler's
+	uint8 smallFiber = 0xFF;
+	uint8 defaultFiber = 0xFF;
+	std::shared_ptr<Job> small = std::make_shared<FuncJob>([sche, &smallFiber]() {
+		sche->YieldPoll(1);
+		smallFiber = FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber->m_StackSize;
+	});
+	small->SetStackSize(Job::StackSize::STACK_SMALL);
+	auto signal = sche->FetchSignal();
+	auto plainJob = sche->PostJob([&defaultFiber]() { defaultFiber = FiberWorker::GetCurrentThreadWorker()->m_CurrentFiber->m_StackSize; });
+	sche->AddPreCondition(signal, plainJob->GetSignal());
+	sche->AddPreCondition(signal, sche->PostJob(small)->GetSignal());
+	sche->YieldFor(signal);
+	ASSERT(sche->GetStackSize(plainJob->GetJob()) == (uint8)Job::StackSize::STACK_MEDIUM);
+	ASSERT(smallFiber == (uint8)Job::StackSize::STACK_SMALL && defaultFiber >= (uint8)Job::StackSize::STACK_MEDIUM);
+	sche->ReleaseIdleStacks();
+}
+
+void TestCase7(FiberScheduler* sche)
+{
+	// a kept handle outlives its job, dropped ones give their record back to the pool
+	auto job = sche->PostJob([]() { TaskAddCounterTS(1); });
+	sche->YieldFor(job->GetSignal());
+	ASSERT(job->GetJob()->IsFinished());
+	auto late = sche->PostJob([]() { TaskAddCounterTS(1); }, job->GetSignal());
+	sche->YieldFor(late->GetSignal());
+
+	uint32 records = 0;
+	for (int32 round = 0; round < 20; ++round)
+	{
+		auto signal = sche->FetchSignal();
+		for (int32 idx = 0; idx < 100; ++idx)
+			sche->AddPreCondition(signal, sche->PostJob([]() { TaskAddCounterTS(1); })->GetSignal());
+		sche->YieldFor(signal);
+		if (round == 0)
+			records = sche->GetJobPool().GetRecordCount();
+	}
+	ASSERT(sche->GetJobPool().GetRecordCount() < records * 2);
+}
+
+void TestCase8(FiberScheduler* sche)
+{
+	// function jobs keep small and move only captures in place, large ones still work
+	std::unique_ptr<int32> value(new int32(3));
+	std::atomic<int32> result(0);
+	std::atomic<bool> release(false);
+	auto gate = sche->PostJob([&release]() { while (!release) std::this_thread::yield(); });
+	auto job = sche->PostJob([&result, value = std::move(value)]() { result += *value; return *value; }, gate->GetSignal());
+	auto completor = job->PostCompletor([&result](int32 preResult) { result += preResult * 10; });
+	// a completor's result is dropped, as it was with std::function
+	auto passOn = job->PostCompletor([](int32 preResult) { return preResult; });
+	release = true;
+	sche->YieldFor(passOn->GetSignal());
+	sche->YieldFor(completor->GetSignal());
+	ASSERT(result == 33);
+
+	std::array<int64, 16> large;
+	large.fill(1);
+	auto largeFunc = [&result, large]() { result = (int32)large.size(); };
+	static_assert(!InlineFunction<void()>::IsInline<decltype(largeFunc)>(), "capture should not fit");
+	auto largeJob = sche->PostJob(std::move(largeFunc));
+	sche->YieldFor(largeJob->GetSignal());
+	ASSERT(result == 16);
+}
+
+void TestCase9(FiberScheduler* sche)
+{
+	// one signal fanning out to more successors than it keeps inline, and a signal armed again after firing
+	threadsafe_counter = 0;
+	std::atomic<bool> release(false);
+	auto gate = sche->PostJob([&release]() { while (!release) std::this_thread::yield(); return 5; });
+	std::vector<JobSignalPtr> signals;
+	std::vector<FiberJobPtr> successors;
+	for (int32 idx = 0; idx < 8; ++idx)
+	{
+		signals.push_back(sche->FetchSignal());
+		sche->AddPreCondition(signals.back(), gate->GetSignal());
+		successors.push_back(gate->PostCompletor([](int32 preResult) { TaskAddCounterTS(preResult); }));
+	}
+	release = true;
+	for (auto& signal : signals)
+		sche->YieldFor(signal);
+	for (auto& successor : successors)
+		sche->YieldFor(successor->GetSignal());
+	ASSERT(threadsafe_counter == 40);
+
+	auto signal = sche->FetchSignal();
+	sche->AddPreCondition(signal, gate->GetSignal());
+	auto pending = sche->PostJob([]() { TaskAddCounterTS(1); }, successors.back()->GetSignal());
+	auto job = sche->PostJob([]() { TaskAddCounterTS(1); });
+	sche->AddPreCondition(signal, job->GetSignal());
+	sche->YieldFor(signal);
+	sche->YieldFor(pending->GetSignal());
+	ASSERT(threadsafe_counter == 42);
+}
+
+void TestCase10(FiberScheduler* sche)
+{
+	// a batch shares one signal, a job list returns one handle per job
+	threadsafe_counter = 0;
+	std::vector<std::function<void()>> funcs;
+	for (int32 idx = 0; idx < 300; ++idx)
+		funcs.push_back([idx]() { TaskAddCounterTS(idx); });
+	sche->YieldFor(sche->PostBatch(funcs.begin(), funcs.end()));
+	ASSERT(threadsafe_counter == 300 * 299 / 2);
+
+	std::vector<std::shared_ptr<Job>> jobs;
+	for (int32 idx = 0; idx < 8; ++idx)
+	{
+		jobs.push_back(std::make_shared<FuncJob>([]() { TaskAddCounterTS(1); }));
+		jobs.back()->SetPriority(idx % 2 ? Job::Priority::PRIO_LOW : Job::Priority::PRIO_TOP);
+	}
+	auto handles = sche->PostJobs(jobs.begin(), jobs.end(), ThreadWorkerFilter::E_WORKER_ON_ANY);
+	ASSERT(handles.size() == 8);
+	for (auto& handle : handles)
+		sche->YieldFor(handle->GetSignal());
+	ASSERT(threadsafe_counter == 300 * 299 / 2 + 8);
+
+	std::vector<std::function<void()>> none;
+	sche->YieldFor(sche->PostBatch(none.begin(), none.end()));
+}
+
+void TestCase11(FiberScheduler* sche)
+{
+	// data parallel loops, joined in order and kept on the filter's workers
+	std::vector<int32> values(100000, 0);
+	sche->ParallelFor(0, values.size(), 256, [&values](SIZET index) { values[index] = (int32)index; });
+	for (SIZET idx = 0; idx < values.size(); ++idx)
+		ASSERT(values[idx] == (int32)idx);
+
+	int64 sum = sche->ParallelReduce((SIZET)0, values.size(), 512, (int64)0,
+		[&values](SIZET begin, SIZET end, int64 value) {
+			for (SIZET idx = begin; idx < end; ++idx)
+				value += values[idx];
+			return value;
+		},
+		[](int64 left, int64 right) { return left + right; });
+	ASSERT(sum == (int64)values.size() * (int64)(values.size() - 1) / 2);
+
+	std::string digits = sche->ParallelReduce((SIZET)0, (SIZET)10, 1, std::string(),
+		[](SIZET begin, SIZET end, std::string value) {
+			for (SIZET idx = begin; idx < end; ++idx)
+				value += (char)('0' + idx);
+			return value;
+		},
+		[](std::string left, std::string right) { return left + right; });
+	ASSERT(digits == "0123456789");
+
+	std::vector<int64> prefix(values.size());
+	int64 total = sche->ParallelScan((SIZET)0, values.size(), 1000, (int64)0,
+		[&values, &prefix](SIZET begin, SIZET end, int64 value, bool final) {
+			for (SIZET idx = begin; idx < end; ++idx)
+			{
+				value += values[idx];
+				if (final)
+					prefix[idx] = value;
+			}
+			return value;
+		},
+		[](int64 left, int64 right) { return left + right; });
+	ASSERT(total == sum);
+	for (SIZET idx = 0; idx < prefix.size(); ++idx)
+		ASSERT(prefix[idx] == (int64)idx * (int64)(idx + 1) / 2);
+
+	std::atomic<int32> onMain(0);
+	sche->ParallelFor(0, 64, 1, [&onMain](SIZET) {
+		ASSERT(ThreadWorker::GetCurrentThreadID() == E_WORKER_MAIN);
+		onMain++;
+	}, ThreadWorkerFilter::E_WORKER_ON_MAIN);
+	ASSERT(onMain == 64);
+}
+
+void TestCase12(FiberScheduler* sche)
+{
+	// an idle worker parks and a job for it wakes it up
+	auto start = std::chrono::steady_clock::now();
+	while (!(sche->GetParkedWorkers() & ThreadWorkerFilter::E_WORKER_ON_MAIN))
+	{
+		ASSERT(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+		std::this_thread::yield();
+	}
+	std::atomic<bool> ran(false);
+	auto job = sche->PostJob([&ran]() { ran = true; }, ThreadWorkerFilter::E_WORKER_ON_MAIN);
+	sche->YieldFor(job->GetSignal());
+	ASSERT(ran);
+}
+
+void TestCase13(FiberScheduler* sche)
+{
+	// idle time is split by phase, power saving parks without spinning or yielding first
+	sche->SetIdlePolicy(IdlePolicy::Preset::POWER_SAVING);
+	auto job = sche->PostJob([]() {}, ThreadWorkerFilter::E_WORKER_ON_MAIN);
+	sche->YieldFor(job->GetSignal());
+
+	// main has gone idle after the job under the new policy, from here on it only parks
+	WorkerStats before = sche->GetStats().m_Workers[0];
+	auto start = std::chrono::steady_clock::now();
+	while (!(sche->GetParkedWorkers() & ThreadWorkerFilter::E_WORKER_ON_MAIN))
+	{
+		ASSERT(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+		std::this_thread::yield();
+	}
+	job = sche->PostJob([]() {}, ThreadWorkerFilter::E_WORKER_ON_MAIN);
+	sche->YieldFor(job->GetSignal());
+	WorkerStats after = sche->GetStats().m_Workers[0];
+	ASSERT(after.m_ParkCount > before.m_ParkCount && after.m_ParkNS > before.m_ParkNS);
+	ASSERT(after.m_IdleNS - after.m_ParkNS == before.m_IdleNS - before.m_ParkNS);
+
+	sche->SetIdlePolicy(IdlePolicy::Preset::LOW_LATENCY);
+	job = sche->PostJob([]() {}, ThreadWorkerFilter::E_WORKER_ON_MAIN);
+	sche->YieldFor(job->GetSignal());
+	sche->SetIdlePolicy(IdlePolicy::Preset::BALANCED);
+}
+
+void TestCase14(FiberScheduler* sche)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// the wheel cascades timers down its levels and hands them out in deadline order
+	{
+		TimerWheel wheel;
+		uint64 base = TimerWheel::Now();
+		const uint64 delays[] = { 5, 63, 64, 4095, 4096, 300000, 70000000, TimerWheel::MAX_DELAY_US + 10 };
+		TimerNode nodes[8];
+		for (int i = 7; i >= 0; --i)
+		{
+			nodes[i].m_DeadlineUS = base + delays[i];
+			wheel.Insert(&nodes[i]);
+		}
+		int expired = 0;
+		for (uint64 now = base; expired < 8;)
+		{
+			now = base + delays[expired];
+			ASSERT(!wheel.Advance(now - 1));
+			ASSERT(wheel.GetRemainTime(now - 1) >= 1);
+			for (TimerNode* node = wheel.Advance(now); node; node = node->m_Next)
+			{
+				ASSERT(node == &nodes[expired]);
+				ASSERT(node->m_DeadlineUS <= now);
+				expired++;
+			}
+		}
+		ASSERT(wheel.GetRemainTime(base) == ~(uint64)0);
+	}
+
+	// delayed jobs don't run before their time
+	{
+		auto start = Clock::now();
+		Clock::time_point ranAfter, ranAt;
+		auto after = sche->PostJobAfter([&ranAfter]() { ranAfter = Clock::now(); }, std::chrono::milliseconds(3));
+		auto at = sche->PostJobAt([&ranAt]() { ranAt = Clock::now(); }, start + std::chrono::milliseconds(1), ThreadWorkerFilter::E_WORKER_ON_MAIN);
+		sche->YieldFor(after->GetSignal());
+		sche->YieldFor(at->GetSignal());
+		ASSERT(ranAfter - start >= std::chrono::milliseconds(3));
+		ASSERT(ranAt - start >= std::chrono::milliseconds(1));
+	}
+
+	// recurring jobs reuse their record until they fail or are aborted
+	{
+		std::atomic<int> count(0);
+		auto job = sche->PostJobEvery([&count]() { return ++count < 5 ? 0 : 1; }, std::chrono::microseconds(200));
+		sche->YieldFor(job->GetSignal());
+		ASSERT(count == 5);
+		ASSERT(job->GetJob()->GetStatus() == Job::Status::STATUS_FAILED);
+
+		const int TASKS = 1000;
+		std::atomic<int> fired(0);
+		std::vector<FiberJobPtr> jobs;
+		for (int i = 0; i < TASKS; ++i)
+			jobs.push_back(sche->PostJobEvery([&fired]() { fired++; }, std::chrono::microseconds(500 + i)));
+		uint32 records = sche->GetJobPool().GetRecordCount();
+		while (fired < TASKS * 3)
+			sche->YieldPoll(1);
+		ASSERT(sche->GetJobPool().GetRecordCount() <= records + 16);
+
+		auto signal = sche->FetchSignal();
+		for (auto& job : jobs)
+		{
+			job->GetJob()->Abort();
+			sche->AddPreCondition(signal, job->GetSignal());
+		}
+		sche->YieldFor(signal);
+	}
+
+	// several fibers of one worker poll at once
+	{
+		std::atomic<int> polls(0);
+		auto signal = sche->FetchSignal();
+		for (int i = 0; i < 4; ++i)
+		{
+			auto job = sche->PostJob([sche, &polls]() {
+				for (int n = 0; n < 3; ++n)
+				{
+					sche->YieldPoll(std::chrono::microseconds(300));
+					polls++;
+				}
+			}, ThreadWorkerFilter::E_WORKER_ON_MAIN);
+			sche->AddPreCondition(signal, job->GetSignal());
+		}
+		sche->YieldFor(signal);
+		ASSERT(polls == 12);
+	}
+}
+
+void TestCase15(FiberScheduler* sche)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// jobs with a deadline run earliest deadline first, ahead of the others
+	uint64 self = ThreadWorker::GetCurrentThreadFilter();
+	{
+		std::vector<int> order;
+		auto now = Clock::now();
+		auto signal = sche->FetchSignal();
+		const int deadlines[] = { 500, 100, 300 };
+		sche->AddPreCondition(signal, sche->PostJob([&order]() { order.push_back(0); }, self)->GetSignal());
+		for (int deadline : deadlines)
+		{
+			auto job = sche->PostJobBefore([&order, deadline]() { order.push_back(deadline); }, now + std::chrono::seconds(deadline), self);
+			sche->AddPreCondition(signal, job->GetSignal());
+		}
+		sche->YieldFor(signal);
+		ASSERT((order == std::vector<int>{ 100, 300, 500, 0 }));
+	}
+
+	// a job that can't start in time is dropped without running
+	{
+		std::atomic<bool> ran(false);
+		std::shared_ptr<Job> job = std::make_shared<FuncJob>([&ran]() { ran = true; });
+		job->SetMaxPeriod(1);
+		auto signal = sche->FetchSignal();
+		std::vector<FiberJobPtr> jobs;
+		for (int i = 0; i < 4; ++i)
+		{
+			jobs.push_back(i == 0 ? sche->PostJob(job, self) : sche->PostJobBefore([&ran]() { ran = true; }, Clock::now(), self));
+			sche->AddPreCondition(signal, jobs.back()->GetSignal());
+		}
+		// keep the only worker that may run them busy past the deadline
+		auto start = Clock::now();
+		while (Clock::now() - start < std::chrono::milliseconds(3)) {}
+		sche->YieldFor(signal);
+		ASSERT(!ran);
+		for (auto& fiberJob : jobs)
+			ASSERT(fiberJob->GetJob()->IsTimeout());
+	}
+}
+
+#if defined(__cpp_impl_coroutine)
+Task<int32> TaskSquare(FiberScheduler* sche, int32 value)
+{
+	int32 square = 0;
+	co_await sche->PostJob([&square, value]() { square = value * value; });
+	co_return square;
+}
+
+Task<int32> TaskSumSquares(FiberScheduler* sche, int32 count)
+{
+	int32 sum = 0;
+	for (int32 i = 1; i <= count; ++i)
+		sum += co_await TaskSquare(sche, i);
+	co_return sum;
+}
+
+Task<void> TaskWait(FiberScheduler* sche, JobSignalPtr signal, std::atomic<int32>* woken)
+{
+	int32 result = co_await signal;
+	ASSERT(result == 7);
+	co_await sche->Schedule(ThreadWorkerFilter::E_WORKER_ON_MAIN);
+	ASSERT(ThreadWorker::GetCurrentThreadID() == E_WORKER_MAIN);
+	(*woken)++;
+}
+
+Task<void> TaskThrow()
+{
+	throw std::runtime_error("task failed");
+	co_return;
+}
+
+void TestCase16(FiberScheduler* sche)
+{
+	// nested tasks and awaited jobs
+	{
+		Task<int32> task = TaskSumSquares(sche, 10);
+		sche->YieldFor(task.Start(*sche));
+		ASSERT(task.GetResult() == 385);
+	}
+
+	// many tasks waiting on one signal only keep their frames, then hop to main
+	{
+		const int32 COUNT = 1000;
+		std::atomic<int32> woken(0);
+		std::atomic<bool> release(false);
+		auto gate = sche->PostJob([&release]() { while (!release) std::this_thread::yield(); return 7; });
+		std::vector<Task<void>> tasks;
+		auto done = sche->FetchSignal();
+		for (int32 i = 0; i < COUNT; ++i)
+		{
+			tasks.push_back(TaskWait(sche, gate->GetSignal(), &woken));
+			sche->AddPreCondition(done, tasks.back().Start(*sche));
+		}
+		release = true;
+		sche->YieldFor(done);
+		ASSERT(woken == COUNT);
+	}
+
+	// exceptions reach the one asking for the result
+	{
+		Task<void> task = TaskThrow();
+		sche->YieldFor(task.Start(*sche));
+		bool caught = false;
+		try { task.GetResult(); }
+		catch (const std::runtime_error&) { caught = true; }
+		ASSERT(caught);
+	}
+}
+#endif
+
+#if defined(__LINUX__)
+void TestCase17(FiberScheduler* sche)
+{
+	const uint32 blockSize = 4096;
+	const uint32 blockCount = 64;
+	std::string path = "/tmp/FiberLibTest_" + std::to_string(getpid()) + ".bin";
+
+	int32 fd = FiberIO::OpenAt(AT_FDCWD, path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	ASSERT(fd >= 0);
+
+	// every block written by its own job, the IO workers keep them all in flight
+	std::vector<std::function<void()>> writers;
+	for (uint32 i = 0; i < blockCount; ++i)
+	{
+		writers.push_back([fd, i, blockSize]() {
+			std::vector<uint8> block(blockSize, (uint8)i);
+			int32 written = FiberIO::Write(fd, block.data(), blockSize, (uint64)i * blockSize);
+			ASSERT(written == (int32)blockSize);
+		});
+	}
+	sche->YieldFor(sche->PostBatch(writers.begin(), writers.end(), ThreadWorkerFilter::E_WORKER_ON_IO));
+	int32 synced = FiberIO::Fsync(fd);
+	ASSERT(synced == 0);
+	synced = FiberIO::Fsync(fd, true);
+	ASSERT(synced == 0);
+
+	std::atomic<uint32> matched(0);
+	std::vector<std::function<void()>> readers;
+	for (uint32 i = 0; i < blockCount * 4; ++i)
+	{
+		readers.push_back([fd, i, blockSize, blockCount, &matched]() {
+			uint32 index = (i * 7) % blockCount;
+			std::vector<uint8> block(blockSize, 0xFF);
+			if (FiberIO::Read(fd, block.data(), blockSize, (uint64)index * blockSize) == (int32)blockSize &&
+				std::all_of(block.begin(), block.end(), [index](uint8 value) { return value == (uint8)index; }))
+				matched++;
+		});
+	}
+	sche->YieldFor(sche->PostBatch(readers.begin(), readers.end()));
+	ASSERT(matched == blockCount * 4);
+
+	// errors come back like the syscalls return them
+	uint8 byte = 0;
+	int32 result = FiberIO::Read(fd, &byte, 1, (uint64)blockCount * blockSize);
+	ASSERT(result == 0);
+	result = FiberIO::Read(-1, &byte, 1, 0);
+	ASSERT(result == -EBADF);
+	result = FiberIO::OpenAt(AT_FDCWD, "/nonexistent/FiberLib", O_RDONLY);
+	ASSERT(result == -ENOENT);
+
+	// a lone read goes to the kernel even while its worker never runs out of jobs
+	{
+		const uint32 limit = 100000;
+		std::atomic<bool> done(false);
+		std::atomic<uint32> busyCount(0);
+		int32 single = -1;
+		// each busy job hangs its successor on the signal before it ends, so it fires with the last one
+		auto chain = sche->FetchSignal();
+		std::function<void()> busy;
+		busy = [&]() {
+			if (!done && ++busyCount < limit)
+				sche->AddPreCondition(chain, sche->PostJob(busy, ThreadWorkerFilter::E_WORKER_ON_IO_2)->GetSignal());
+		};
+		// the reader queues its request with the first busy job already queued on its worker
+		auto reader = sche->PostJob([&]() {
+			sche->AddPreCondition(chain, sche->PostJob(busy, ThreadWorkerFilter::E_WORKER_ON_IO_2)->GetSignal());
+			uint8 value = 0xFF;
+			single = FiberIO::Read(fd, &value, 1, 0);
+			done = true;
+		}, ThreadWorkerFilter::E_WORKER_ON_IO_2);
+		// the test itself may run on IO_2, it must not hold the worker while the chain runs out
+		sche->YieldFor(reader->GetSignal());
+		sche->YieldFor(chain);
+		ASSERT(single == 1 && busyCount < limit);
+	}
+
+	result = FiberIO::Close(fd);
+	ASSERT(result == 0);
+	unlink(path.c_str());
+}
+
+void TestCase18(FiberScheduler* sche)
+{
+	// a receiver waits for the socket without holding its worker
+	{
+		int32 pair[2];
+		int32 result = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair);
+		ASSERT(result == 0);
+		char message[6] = {};
+		int32 receivedCount = 0;
+		auto receiver = sche->PostJob([&]() { receivedCount = FiberIO::Recv(pair[1], message, 5); }, ThreadWorkerFilter::E_WORKER_ON_IO_1);
+		std::atomic<bool> ran(false);
+		sche->YieldFor(sche->PostJob([&ran]() { ran = true; }, ThreadWorkerFilter::E_WORKER_ON_IO_1)->GetSignal());
+		ASSERT(ran);
+		result = FiberIO::Send(pair[0], "hello", 5);
+		ASSERT(result == 5);
+		sche->YieldFor(receiver->GetSignal());
+		ASSERT(receivedCount == 5 && std::string(message) == "hello");
+
+		// a sender blocked on a full socket buffer goes on as the other side drains it
+		const uint32 total = 1 << 20;
+		std::vector<uint8> data(total);
+		for (uint32 i = 0; i < total; ++i)
+			data[i] = (uint8)(i * 31);
+		std::vector<uint8> received;
+		auto sender = sche->PostJob([&]() {
+			for (uint32 sent = 0; sent < total;)
+			{
+				int32 count = FiberIO::Send(pair[0], data.data() + sent, total - sent);
+				if (count <= 0)
+					break;
+				sent += (uint32)count;
+			}
+			FiberIO::Close(pair[0]);
+		});
+		uint8 buffer[16 * 1024];
+		int32 count = 0;
+		while ((count = FiberIO::Recv(pair[1], buffer, sizeof(buffer))) > 0)
+			received.insert(received.end(), buffer, buffer + count);
+		sche->YieldFor(sender->GetSignal());
+		ASSERT(count == 0);
+		ASSERT(received == data);
+		FiberIO::Close(pair[1]);
+	}
+
+	// echo server on loopback, every connection handled by its own job
+	{
+		int32 listener = FiberIO::Socket(AF_INET, SOCK_STREAM);
+		ASSERT(listener >= 0);
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t addrLen = sizeof(addr);
+		int32 result = bind(listener, (sockaddr*)&addr, addrLen);
+		ASSERT(result == 0);
+		result = listen(listener, 128);
+		ASSERT(result == 0);
+		result = getsockname(listener, (sockaddr*)&addr, &addrLen);
+		ASSERT(result == 0);
+
+		const uint32 clientCount = 64;
+		auto server = sche->PostJob([&]() {
+			std::vector<FiberJobPtr> handlers;
+			for (uint32 i = 0; i < clientCount; ++i)
+			{
+				int32 connection = FiberIO::Accept(listener);
+				if (connection < 0)
+					break;
+				handlers.push_back(sche->PostJob([connection]() {
+					uint32 value = 0;
+					if (FiberIO::Recv(connection, &value, sizeof(value), MSG_WAITALL) == (int32)sizeof(value))
+					{
+						value *= 2;
+						FiberIO::Send(connection, &value, sizeof(value));
+					}
+					FiberIO::Close(connection);
+				}));
+			}
+			for (auto& handler : handlers)
+				sche->YieldFor(handler->GetSignal());
+		}, ThreadWorkerFilter::E_WORKER_ON_IO_2);
+
+		std::atomic<uint32> echoed(0);
+		std::vector<std::function<void()>> clients;
+		for (uint32 i = 0; i < clientCount; ++i)
+		{
+			clients.push_back([&addr, &echoed, i]() {
+				int32 fd = FiberIO::Socket(AF_INET, SOCK_STREAM);
+				uint32 value = i;
+				if (FiberIO::Connect(fd, (const sockaddr*)&addr, sizeof(addr)) == 0 &&
+					FiberIO::Send(fd, &value, sizeof(value)) == (int32)sizeof(value) &&
+					FiberIO::Recv(fd, &value, sizeof(value), MSG_WAITALL) == (int32)sizeof(value) && value == i * 2)
+					echoed++;
+				FiberIO::Close(fd);
+			});
+		}
+		sche->YieldFor(sche->PostBatch(clients.begin(), clients.end()));
+		sche->YieldFor(server->GetSignal());
+		ASSERT(echoed == clientCount);
+
+		// nobody listens once the listener is closed
+		FiberIO::Close(listener);
+		int32 fd = FiberIO::Socket(AF_INET, SOCK_STREAM);
+		result = FiberIO::Connect(fd, (const sockaddr*)&addr, sizeof(addr));
+		ASSERT(result == -ECONNREFUSED);
+		FiberIO::Close(fd);
+	}
+}
+#endif
+
+void TestCase19(FiberScheduler* sche)
+{
+	// lock holders park while holding the mutex, the waiters park behind them
+	{
+		FiberMutex mutex;
+		uint32 counter = 0;
+		std::vector<std::function<void()>> jobs;
+		for (uint32 i = 0; i < 64; ++i)
+		{
+			jobs.push_back([&, i]() {
+				for (uint32 n = 0; n < 100; ++n)
+				{
+					std::lock_guard<FiberMutex> lock(mutex);
+					uint32 value = counter;
+					if (n % 25 == 0)
+						sche->YieldPoll(TimerUS(20));
+					counter = value + 1;
+				}
+			});
+		}
+		sche->YieldFor(sche->PostBatch(jobs.begin(), jobs.end()));
+		ASSERT(counter == 6400);
+		ASSERT(mutex.TryLock());
+		mutex.Unlock();
+	}
+
+	// consumers wait on the condition until the producer is done
+	{
+		FiberMutex mutex;
+		FiberConditionVariable condition;
+		std::vector<uint32> items;
+		bool done = false;
+		std::atomic<uint32> consumed(0);
+		std::vector<std::function<void()>> consumers;
+		for (uint32 i = 0; i < 16; ++i)
+		{
+			consumers.push_back([&]() {
+				std::unique_lock<FiberMutex> lock(mutex);
+				for (;;)
+				{
+					condition.Wait(mutex, [&]() { return !items.empty() || done; });
+					if (items.empty())
+						break;
+					items.pop_back();
+					consumed++;
+				}
+			});
+		}
+		JobSignalPtr signal = sche->PostBatch(consumers.begin(), consumers.end());
+		for (uint32 i = 0; i < 1000; ++i)
+		{
+			std::lock_guard<FiberMutex> lock(mutex);
+			items.push_back(i);
+			condition.NotifyOne();
+		}
+		{
+			std::lock_guard<FiberMutex> lock(mutex);
+			done = true;
+		}
+		condition.NotifyAll();
+		sche->YieldFor(signal);
+		ASSERT(consumed == 1000);
+	}
+
+	// far more jobs wait on the semaphore than there are workers, none of them holds its worker
+	{
+		FiberSemaphore semaphore(0);
+		std::atomic<int32> inside(0);
+		std::atomic<int32> most(0);
+		std::vector<std::function<void()>> jobs;
+		for (uint32 i = 0; i < 128; ++i)
+		{
+			jobs.push_back([&]() {
+				semaphore.Acquire();
+				int32 now = ++inside;
+				int32 seen = most.load();
+				while (now > seen && !most.compare_exchange_weak(seen, now)) {}
+				sche->YieldPoll(TimerUS(10));
+				--inside;
+				semaphore.Release();
+			});
+		}
+		JobSignalPtr signal = sche->PostBatch(jobs.begin(), jobs.end());
+		sche->YieldPoll(TimerUS(1000));
+		semaphore.Release(3);
+		sche->YieldFor(signal);
+		ASSERT(most <= 3 && most >= 1);
+		ASSERT(semaphore.GetCount() == 3);
+	}
+
+	// every participant sees the whole phase before the next one starts
+	{
+		const uint32 count = 12;
+		FiberBarrier barrier(count);
+		std::atomic<uint32> arrived[3] = {};
+		std::atomic<uint32> completers(0);
+		std::atomic<bool> ordered(true);
+		std::vector<std::function<void()>> jobs;
+		for (uint32 i = 0; i < count; ++i)
+		{
+			jobs.push_back([&]() {
+				for (uint32 phase = 0; phase < 3; ++phase)
+				{
+					arrived[phase]++;
+					if (barrier.ArriveAndWait())
+						completers++;
+					if (arrived[phase] != count)
+						ordered = false;
+				}
+			});
+		}
+		sche->YieldFor(sche->PostBatch(jobs.begin(), jobs.end()));
+		ASSERT(ordered);
+		ASSERT(completers == 3);
+	}
+}
+
+void TestCase20(FiberScheduler* sche)
+{
+	// far more producers and consumers than slots, everybody parks on the full or empty channel
+	{
+		Channel<uint32> channel(8);
+		std::atomic<uint64> sum(0);
+		std::atomic<uint32> received(0);
+		std::vector<std::function<void()>> producers;
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			producers.push_back([&, i]() {
+				uint32 values[50];
+				for (uint32 n = 0; n < 500; n += 50)
+				{
+					for (uint32 k = 0; k < 50; ++k)
+						values[k] = i * 500 + n + k;
+					if (n % 100 == 0)
+					{
+						uint32 sent = channel.SendN(values, 50);
+						ASSERT(sent == 50);
+					}
+					else
+					{
+						for (uint32 k = 0; k < 50; ++k)
+						{
+							bool sent = channel.Send(values[k]);
+							ASSERT(sent);
+						}
+					}
+				}
+			});
+		}
+		std::vector<std::function<void()>> consumers;
+		for (uint32 i = 0; i < 6; ++i)
+		{
+			consumers.push_back([&, i]() {
+				uint32 values[16];
+				uint64 local = 0;
+				uint32 count = 0;
+				if (i % 2 == 0)
+				{
+					while (uint32 n = channel.RecvN(values, 16))
+					{
+						for (uint32 k = 0; k < n; ++k)
+							local += values[k];
+						count += n;
+					}
+				}
+				else
+				{
+					uint32 value;
+					while (channel.Recv(value))
+					{
+						local += value;
+						count++;
+					}
+				}
+				sum += local;
+				received += count;
+			});
+		}
+		JobSignalPtr consumed = sche->PostBatch(consumers.begin(), consumers.end());
+		sche->YieldFor(sche->PostBatch(producers.begin(), producers.end()));
+		channel.Close();
+		sche->YieldFor(consumed);
+		ASSERT(received == 4000);
+		ASSERT(sum == (uint64)3999 * 4000 / 2);
+		ASSERT(channel.GetSize() == 0);
+	}
+
+	// a closed channel refuses sends and still hands out what it holds
+	{
+		Channel<std::unique_ptr<uint32>> channel(3);
+		ASSERT(channel.GetCapacity() == 4);
+		for (uint32 i = 0; i < 4; ++i)
+		{
+			bool sent = channel.TrySend(std::make_unique<uint32>(i));
+			ASSERT(sent);
+		}
+		std::unique_ptr<uint32> extra = std::make_unique<uint32>(4);
+		bool full = channel.TrySend(std::move(extra));
+		ASSERT(!full && extra);
+		channel.Close();
+		bool closed = channel.Send(std::move(extra));
+		ASSERT(!closed && extra);
+		std::unique_ptr<uint32> value;
+		bool first = channel.Recv(value);
+		ASSERT(first && *value == 0);
+		// the rest is destroyed with the channel
+	}
+}
+
+void TestCase21(FiberScheduler* sche)
+{
+	std::pmr::memory_resource* resource = sche->GetFrameResource();
+
+	// a block freed on another worker goes back to its owner, which gets it again once its own list is empty
+	{
+		void* first = nullptr;
+		void* second = nullptr;
+		sche->YieldFor(sche->PostJob([&]() { first = resource->allocate(3000); }, ThreadWorkerFilter::E_WORKER_ON_SHARED_1)->GetSignal());
+		sche->YieldFor(sche->PostJob([&]() { resource->deallocate(first, 3000); }, ThreadWorkerFilter::E_WORKER_ON_SHARED_2)->GetSignal());
+		sche->YieldFor(sche->PostJob([&]() { second = resource->allocate(3000); }, ThreadWorkerFilter::E_WORKER_ON_SHARED_1)->GetSignal());
+		ASSERT(first && first == second);
+		sche->YieldFor(sche->PostJob([&]() { resource->deallocate(second, 3000); }, ThreadWorkerFilter::E_WORKER_ON_SHARED_1)->GetSignal());
+	}
+
+	// producers allocate, consumers on other workers free, the spans are reused round after round
+	{
+		std::atomic<bool> intact(true);
+		uint32 spans = 0;
+		for (uint32 round = 0; round < 20; ++round)
+		{
+			Channel<uint8*> channel(64);
+			std::vector<std::function<void()>> consumers;
+			for (uint32 i = 0; i < 4; ++i)
+			{
+				consumers.push_back([&]() {
+					uint8* block;
+					while (channel.Recv(block))
+					{
+						SIZET size = (SIZET)block[0] * 48;
+						if (block[size - 1] != block[0])
+							intact = false;
+						resource->deallocate(block, size);
+					}
+				});
+			}
+			JobSignalPtr consumed = sche->PostBatch(consumers.begin(), consumers.end());
+			std::vector<std::function<void()>> producers;
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				producers.push_back([&, i]() {
+					for (uint32 n = 0; n < 1024; ++n)
+					{
+						uint8 tag = (uint8)((i + n) % 8 + 1);
+						uint8* block = static_cast<uint8*>(resource->allocate((SIZET)tag * 48));
+						block[0] = tag;
+						block[(SIZET)tag * 48 - 1] = tag;
+						channel.Send(block);
+					}
+				});
+			}
+			sche->YieldFor(sche->PostBatch(producers.begin(), producers.end()));
+			channel.Close();
+			sche->YieldFor(consumed);
+			if (round == 1)
+				spans = sche->GetPoolResource().GetSpanCount();
+		}
+		ASSERT(intact);
+		// without reuse the 20 rounds would take well over a thousand spans
+		ASSERT(sche->GetPoolResource().GetSpanCount() < spans + 200);
+	}
+
+	// threads that aren't workers share a cache, big blocks go upstream
+	{
+		std::thread thread([&]() {
+			std::vector<void*> blocks;
+			for (uint32 i = 0; i < 256; ++i)
+				blocks.push_back(resource->allocate(64 + i));
+			void* big = resource->allocate(64 * KILOBYTE, 64);
+			for (uint32 i = 0; i < 256; ++i)
+				resource->deallocate(blocks[i], 64 + i);
+			resource->deallocate(big, 64 * KILOBYTE, 64);
+		});
+		thread.join();
+	}
+}
+
+void TestCase22(FiberScheduler* sche)
+{
+	// the same graph every tick, fan out then a join, with captures too big for the job record
+	{
+		SIZET reserved = 0;
+		for (uint32 tick = 0; tick < 100; ++tick)
+		{
+			EpochScope epoch = sche->BeginEpoch();
+			std::atomic<uint64>* sum = epoch->New<std::atomic<uint64>>(0);
+			JobSignalPtr fanned = sche->FetchSignal();
+			std::vector<FiberJobPtr> jobs;
+			for (uint32 i = 0; i < 32; ++i)
+			{
+				std::array<uint64, 16> values;
+				for (uint32 k = 0; k < 16; ++k)
+					values[k] = tick + i + k;
+				jobs.push_back(epoch->PostJob([sum, values]() {
+					for (uint64 value : values)
+						*sum += value;
+				}));
+			}
+			for (auto& job : jobs)
+				sche->AddPreCondition(fanned, job->GetSignal());
+			std::atomic<uint64> total(0);
+			epoch->PostJob([sum, &total]() { total = sum->load(); }, fanned);
+			sche->YieldFor(epoch.End());
+
+			uint64 expected = 0;
+			for (uint32 i = 0; i < 32; ++i)
+				for (uint32 k = 0; k < 16; ++k)
+					expected += tick + i + k;
+			ASSERT(total == expected);
+		}
+		EpochScope epoch = sche->BeginEpoch();
+		reserved = epoch->GetReserved();
+		// the arenas are kept between ticks, a tick takes a few kilobytes
+		ASSERT(reserved > 0 && reserved <= 8 * EpochArena::CHUNK_SIZE);
+	}
+
+	// jobs of the epoch post more jobs to it, the epoch only ends after all of them
+	{
+		std::atomic<uint32> count(0);
+		std::shared_ptr<uint32> shared = std::make_shared<uint32>(7);
+		EpochScope epoch = sche->BeginEpoch();
+		JobEpoch* self = &*epoch;
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			epoch->PostJob([self, &count, shared]() {
+				for (uint32 n = 0; n < 8; ++n)
+				{
+					std::array<uint8, 128> payload{};
+					payload[0] = (uint8)n;
+					self->PostJob([&count, payload, shared]() { count += payload[0] + *shared - 7 + 1; });
+				}
+			});
+		}
+		sche->YieldFor(epoch.End());
+		ASSERT(count == 8 * (8 + 28));
+		// the big captures were destroyed when they ran, the small ones go with their records
+		ASSERT(shared.use_count() <= 1 + 8);
+	}
+
+	// a job of the epoch dropped past its deadline still lets the epoch end, once its handle is let go
+	{
+		std::atomic<bool> ran(false);
+		EpochScope epoch = sche->BeginEpoch();
+		auto gate = sche->PostJobAfter([]() {}, std::chrono::milliseconds(20));
+		auto late = epoch->PostJob([&ran]() { ran = true; }, gate->GetSignal());
+		late->SetMaxPeriod(1);
+		sche->YieldFor(late->GetSignal());
+		ASSERT(!ran && late->GetJob()->IsTimeout());
+		late = nullptr;
+		sche->YieldFor(epoch.End());
+	}
+}
+
+void TestCase23(FiberScheduler* sche)
+{
+	const char* path = "FiberTraceTest.json";
+	FiberTrace::Clear();
+	FiberTrace::Enable(true);
+
+	// events of any thread, user events keep their name
+	for (uint32 i = 0; i < 16; ++i)
+		FiberTrace::Record(FiberTrace::EventType::USER, i, "Marker", i * 2);
+	std::thread other([]() { FiberTrace::Record(FiberTrace::EventType::USER, 100, "Other \"thread\""); });
+	other.join();
+	SIZET recorded = FiberTrace::GetEventCount();
+	ASSERT(recorded >= 17);
+
+#if defined(__TRACING__)
+	// the scheduler records posts, runs and waits of jobs named by the scope they were posted in
+	{
+		FiberTrace::JobNameScope name("TracedJob");
+		auto slow = sche->PostJob([]() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+		auto waiter = sche->PostJob([sche, slow]() { sche->YieldFor(slow->GetSignal()); });
+		sche->YieldFor(waiter->GetSignal());
+	}
+	SIZET traced = FiberTrace::GetEventCount();
+	ASSERT(traced > recorded + 4);
+#endif
+
+	FiberTrace::Enable(false);
+	bool written = FiberTrace::WriteChromeJson(path);
+	ASSERT(written);
+	std::ifstream file(path);
+	std::stringstream content;
+	content << file.rdbuf();
+	std::string json = content.str();
+	ASSERT(json.find("\"traceEvents\"") != std::string::npos);
+	ASSERT(json.find("\"Marker\"") != std::string::npos);
+	ASSERT(json.find("\"Other \\\"thread\\\"\"") != std::string::npos);
+#if defined(__TRACING__)
+	ASSERT(json.find("\"TracedJob\"") != std::string::npos);
+	ASSERT(json.find("\"ph\":\"s\"") != std::string::npos);
+#endif
+	file.close();
+	remove(path);
+
+	// a cleared trace is empty until recording again
+	FiberTrace::Clear();
+	SIZET cleared = FiberTrace::GetEventCount();
+	ASSERT(cleared == 0);
+	(void)sche;
+}
+
+void TestCase24(FiberScheduler* sche)
+{
+	// buckets cover every value within an eighth of it
+	{
+		uint32 zero = LatencyHistogram::GetBucket(0);
+		uint32 small = LatencyHistogram::GetBucket(15);
+		uint32 last = LatencyHistogram::GetBucket(~(uint64)0);
+		ASSERT(zero == 0 && small == 15 && last == LatencyHistogram::BUCKET_COUNT - 1);
+		for (uint64 value = 1; value < LatencyHistogram::MAX_NS; value = value * 3 + 1)
+		{
+			uint32 bucket = LatencyHistogram::GetBucket(value);
+			uint64 low = LatencyHistogram::GetBucketLow(bucket);
+			uint64 high = LatencyHistogram::GetBucketLow(bucket + 1);
+			ASSERT(low <= value && value < high && high - low <= (TMAX(low / 8, (uint64)1)));
+		}
+
+		LatencyHistogram histogram;
+		for (uint64 value = 1; value <= 1000; ++value)
+			histogram.Add(value * 1000);
+		uint64 median = histogram.GetPercentile(0.5);
+		uint64 tail = histogram.GetPercentile(0.99);
+		ASSERT(histogram.m_Count == 1000 && histogram.m_MaxNS == 1000000);
+		ASSERT(median > 440000 && median < 560000);
+		ASSERT(tail > 900000 && tail <= 1000000);
+	}
+
+	// the snapshot sees the jobs run since the last one, per priority
+	SchedulerStats before = sche->GetStats();
+	std::vector<FiberJobPtr> jobs;
+	for (uint32 i = 0; i < 64; ++i)
+	{
+		std::shared_ptr<Job> job = std::make_shared<FuncJob>([]() {});
+		job->SetPriority(Job::Priority::PRIO_COMPUTE);
+		jobs.push_back(sche->PostJob(job));
+	}
+	std::shared_ptr<Job> slow = std::make_shared<FuncJob>([]() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+	slow->SetPriority(Job::Priority::PRIO_IO);
+	jobs.push_back(sche->PostJob(slow));
+	for (auto& job : jobs)
+		sche->YieldFor(job->GetSignal());
+	SchedulerStats after = sche->GetStats();
+
+	const int32 compute = (int32)Job::Priority::PRIO_COMPUTE;
+	const int32 io = (int32)Job::Priority::PRIO_IO;
+	ASSERT(after.m_Workers.size() == before.m_Workers.size() && !after.m_Workers.empty());
+	ASSERT(after.m_Total.m_JobsExecuted >= before.m_Total.m_JobsExecuted + 65);
+	ASSERT(after.m_QueueLatency[compute].m_Count >= before.m_QueueLatency[compute].m_Count + 64);
+	ASSERT(after.m_RunTime[io].m_Count >= before.m_RunTime[io].m_Count + 1);
+	ASSERT(after.m_RunTime[io].m_MaxNS >= 2000000);
+	// waiting on the slow job suspended this fiber, which takes another one from the pool or a new one
+	ASSERT(after.m_Total.m_ContextSwitches > before.m_Total.m_ContextSwitches);
+	ASSERT(after.m_Total.m_FibersCreated + after.m_Total.m_FibersReused > before.m_Total.m_FibersCreated + before.m_Total.m_FibersReused);
+
+	uint64 executed = 0;
+	for (auto& worker : after.m_Workers)
+		executed += worker.m_JobsExecuted;
+	ASSERT(executed == after.m_Total.m_JobsExecuted);
+}
+
+#if defined(__LINUX__)
+void TestCase25(FiberScheduler* sche)
+{
+	ASSERT(CpuTopology::ParseCpuList("0-2,5,7-8") == std::vector<uint32>({ 0, 1, 2, 5, 7, 8 }));
+
+	// two nodes with an L3 each, two cores per L3 and two siblings per core, numbered the way Linux does
+	char root[] = "/tmp/FiberLibTopologyXXXXXX";
+	ASSERT(mkdtemp(root) != nullptr);
+	std::vector<std::string> created;
+	auto write = [&root, &created](std::string path, const std::string& text) {
+		path = root + path;
+		for (SIZET slash = path.find('/', strlen(root) + 1); slash != std::string::npos; slash = path.find('/', slash + 1))
+		{
+			if (mkdir(path.substr(0, slash).c_str(), 0755) == 0)
+				created.push_back(path.substr(0, slash));
+		}
+		std::ofstream(path) << text << "\n";
+		created.push_back(path);
+	};
+	write("/cpu/online", "0-7");
+	for (uint32 cpu = 0; cpu < 8; ++cpu)
+	{
+		std::string path = "/cpu/cpu" + std::to_string(cpu);
+		uint32 core = cpu % 4;
+		write(path + "/topology/thread_siblings_list", std::to_string(core) + "," + std::to_string(core + 4));
+		write(path + "/topology/physical_package_id", "0");
+		write(path + "/cache/index0/level", "1");
+		write(path + "/cache/index0/shared_cpu_list", std::to_string(core) + "," + std::to_string(core + 4));
+		write(path + "/cache/index1/level", "3");
+		write(path + "/cache/index1/shared_cpu_list", core < 2 ? "0-1,4-5" : "2-3,6-7");
+	}
+	write("/node/node0/cpulist", "0-1,4-5");
+	write("/node/node1/cpulist", "2-3,6-7");
+
+	CpuTopology topology = CpuTopology::Load(root);
+	ASSERT(topology.GetCpus().size() == 8);
+	ASSERT(topology.GetCoreCount() == 4 && topology.GetL3Count() == 2 && topology.GetNodeCount() == 2);
+	ASSERT(topology.GetDistance(0, 4) == CpuTopology::SAME_CORE);
+	ASSERT(topology.GetDistance(0, 5) == CpuTopology::SAME_L3);
+	ASSERT(topology.GetDistance(1, 6) == CpuTopology::REMOTE);
+
+	auto firstCpus = [&topology](AffinityPolicy policy) {
+		std::vector<uint32> cpus;
+		for (auto& set : topology.Place(policy, 9))
+			cpus.push_back(set.size() == 1 ? set.front() : ~0u);
+		return cpus;
+	};
+	ASSERT(firstCpus(AffinityPolicy::COMPACT) == std::vector<uint32>({ 0, 4, 1, 5, 2, 6, 3, 7, 0 }));
+	ASSERT(firstCpus(AffinityPolicy::SCATTER) == std::vector<uint32>({ 0, 2, 1, 3, 4, 6, 5, 7, 0 }));
+	auto cores = topology.Place(AffinityPolicy::ONE_PER_CORE, 5);
+	ASSERT(cores[0] == std::vector<uint32>({ 0, 4 }) && cores[3] == std::vector<uint32>({ 3, 7 }) && cores[4] == cores[0]);
+	ASSERT(topology.Place(AffinityPolicy::NONE, 2)[1].empty());
+	for (auto it = created.rbegin(); it != created.rend(); ++it)
+		remove(it->c_str());
+	rmdir(root);
+
+	// workers run where they were placed and steal from their neighbours first
+	{
+		std::unique_ptr<FiberScheduler> pinned(new FiberScheduler);
+		pinned->SetAffinityPolicy(AffinityPolicy::COMPACT);
+		pinned->InitWorker(8);
+		const CpuTopology& local = CpuTopology::Get();
+		std::array<bool, 8> matches{};
+		std::atomic<uint32> done(0);
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			pinned->PostJob([&pinned, &matches, &done, i]() {
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				sched_getaffinity(0, sizeof(set), &set);
+				const std::vector<uint32>& cpus = pinned->GetWorkerByID(i)->GetAffinity();
+				bool match = !cpus.empty() && CPU_COUNT(&set) == (int)cpus.size();
+				for (uint32 cpu : cpus)
+					match = match && CPU_ISSET(cpu, &set);
+				matches[i] = match;
+				done.fetch_add(1, std::memory_order_release);
+			}, (uint64)1 << i);
+		}
+		// the jobs belong to the other scheduler, so wait for them without suspending
+		while (done.load(std::memory_order_acquire) < 8)
+			std::this_thread::yield();
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			FiberWorker* thief = pinned->GetWorkerByID(i);
+			ASSERT(matches[i] && thief->m_Victims.size() == 7);
+			for (SIZET v = 1; v < thief->m_Victims.size(); ++v)
+			{
+				uint32 cpu = thief->GetAffinity().front();
+				ASSERT(local.GetDistance(cpu, thief->m_Victims[v - 1]->GetAffinity().front()) <= local.GetDistance(cpu, thief->m_Victims[v]->GetAffinity().front()));
+			}
+		}
+	}
+
+	// without a policy the threads are left to the OS, and each worker steals from the ones after it in turn
+	SIZET count = sche->GetStats().m_Workers.size();
+	for (uint32 i = 0; i < count; ++i)
+	{
+		FiberWorker* thief = sche->GetWorkerByID(i);
+		ASSERT(thief->GetAffinity().empty() && thief->m_Victims.size() == count - 1);
+		for (SIZET v = 0; v < thief->m_Victims.size(); ++v)
+			ASSERT(thief->m_Victims[v] == sche->GetWorkerByID((uint32)((i + 1 + v) % count)));
+	}
+}
+#endif
+
 void TestFiber(FiberScheduler* sche)
 {
 	// post job to any thread
@@ -184,6 +1476,34 @@ int main(int, char* [])
 		TestCase1(scheduler);
 		TestCase2(scheduler);
 		TestCase3(scheduler);
+		TestCase4(scheduler);
+		TestCase5(scheduler);
+		TestCase6(scheduler);
+		TestCase7(scheduler);
+		TestCase8(scheduler);
+		TestCase9(scheduler);
+		TestCase10(scheduler);
+		TestCase11(scheduler);
+		TestCase12(scheduler);
+		TestCase13(scheduler);
+		TestCase14(scheduler);
+		TestCase15(scheduler);
+#if defined(__cpp_impl_coroutine)
+		TestCase16(scheduler);
+#endif
+#if defined(__LINUX__)
+		TestCase17(scheduler);
+		TestCase18(scheduler);
+#endif
+		TestCase19(scheduler);
+		TestCase20(scheduler);
+		TestCase21(scheduler);
+		TestCase22(scheduler);
+		TestCase23(scheduler);
+		TestCase24(scheduler);
+#if defined(__LINUX__)
+		TestCase25(scheduler);
+#endif
 		semaphore.Notify();
 	});
 	semaphore.Wait();